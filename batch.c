@@ -0,0 +1,446 @@
+#include "batch.h"
+#include "pool.h"
+#include "cache.h"
+#include "export.h"
+#include "poster.h"
+
+#include <string.h>
+
+//The longest line read from a script
+#define BATCH_LINE 1024
+
+//The most words read from one line of a script
+#define BATCH_WORDS 16
+
+//The sidelength of the gif when none is given
+#define BATCH_SIZE 480
+
+//Everything read from the settings so far
+typedef struct Batch
+{
+    char output[BATCH_LINE];
+    char trace[BATCH_LINE];
+    int size;
+    Render_Mode mode;
+
+    int shards;
+    int shard; //The only shard rendered, -1 to render them all
+    int merge; //Whether only the fragments of the shards are merged
+    int checkpoint; //Seconds between checkpoints, -1 to leave it to CHECKPOINT_ENV
+    int threads; //0 for the default of newPool
+    int cache; //Whether frames share tiles through a cache
+    int quiet; //Whether the progress line is left out
+
+    //A poster of the first keyframe is rendered instead of a gif when its width is not 0
+    int poster_width;
+    int poster_height;
+    char pyramid[BATCH_LINE];
+
+    Timeline* timeline;
+    char save[BATCH_LINE]; //Where the keyframes are saved as a timeline file, empty for nowhere
+} Batch;
+
+//RETURN the number of values the setting name takes, or -1 if there is no such setting
+static int batch_values(const char* name)
+{
+    if(strcmp(name, "output") == 0 || strcmp(name, "trace") == 0 || strcmp(name, "size") == 0 || strcmp(name, "mode") == 0 || strcmp(name, "script") == 0) return 1;
+    if(strcmp(name, "shards") == 0 || strcmp(name, "shard") == 0 || strcmp(name, "checkpoint") == 0 || strcmp(name, "threads") == 0) return 1;
+    if(strcmp(name, "merge") == 0 || strcmp(name, "no-cache") == 0 || strcmp(name, "quiet") == 0) return 0;
+    if(strcmp(name, "poster") == 0) return 2;
+    if(strcmp(name, "pyramid") == 0 || strcmp(name, "timeline") == 0 || strcmp(name, "save-timeline") == 0) return 1;
+    if(strcmp(name, "key") == 0) return 4;
+    return -1;
+}
+
+//RETURN whether text is a whole number, stored in p_value
+static int parse_int(const char* text, int* p_value)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if(end == text || *end != '\0' || value < 0 || value > 1 << 30) return 0;
+    *p_value = (int) value;
+    return 1;
+}
+
+//RETURN whether text is a finite number, stored in p_value
+static int parse_coordinate(const char* text, long double* p_value)
+{
+    char* end;
+    *p_value = strtold(text, &end);
+    return end != text && *end == '\0' && isfinite(*p_value);
+}
+
+static int batch_script(Batch* batch, const char* path);
+
+/*
+    APPLIES one setting to batch. RETURNS 0 on success, -1 after printing why the setting is invalid
+
+    \param batch The settings read so far
+    \param name The name of the setting, without a leading "--"
+    \param values Its values, as many as batch_values(name)
+*/
+static int batch_setting(Batch* batch, const char* name, char** values)
+{
+    if(strcmp(name, "output") == 0)
+    {
+        snprintf(batch->output, sizeof(batch->output), "%s", values[0]);
+        return 0;
+    }
+
+    if(strcmp(name, "trace") == 0)
+    {
+        snprintf(batch->trace, sizeof(batch->trace), "%s", values[0]);
+        return 0;
+    }
+
+    if(strcmp(name, "size") == 0)
+    {
+        if(!parse_int(values[0], &batch->size) || batch->size == 0)
+        {
+            printf("Invalid size %s\n", values[0]);
+            return -1;
+        }
+        if(batch->size > GIF_MAX_SIZE)
+        {
+            printf("Invalid size %s, gifs are at most %d pixels across\n", values[0], GIF_MAX_SIZE);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "mode") == 0)
+    {
+        if(strcmp(values[0], "brute") == 0) batch->mode = RENDER_BRUTE_FORCE;
+        else if(strcmp(values[0], "subdivide") == 0) batch->mode = RENDER_SUBDIVIDE;
+        else if(strcmp(values[0], "progressive") == 0) batch->mode = RENDER_PROGRESSIVE;
+        else
+        {
+            printf("Unknown mode %s, expected brute, subdivide or progressive\n", values[0]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "shards") == 0)
+    {
+        if(!parse_int(values[0], &batch->shards) || batch->shards == 0)
+        {
+            printf("Invalid number of shards %s\n", values[0]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "shard") == 0)
+    {
+        if(!parse_int(values[0], &batch->shard))
+        {
+            printf("Invalid shard %s\n", values[0]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "merge") == 0)
+    {
+        batch->merge = 1;
+        return 0;
+    }
+
+    if(strcmp(name, "checkpoint") == 0)
+    {
+        if(!parse_int(values[0], &batch->checkpoint))
+        {
+            printf("Invalid checkpoint interval %s\n", values[0]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "threads") == 0)
+    {
+        if(!parse_int(values[0], &batch->threads) || batch->threads == 0)
+        {
+            printf("Invalid number of threads %s\n", values[0]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "no-cache") == 0)
+    {
+        batch->cache = 0;
+        return 0;
+    }
+
+    if(strcmp(name, "quiet") == 0)
+    {
+        batch->quiet = 1;
+        return 0;
+    }
+
+    if(strcmp(name, "poster") == 0)
+    {
+        if(!parse_int(values[0], &batch->poster_width) || !parse_int(values[1], &batch->poster_height) || batch->poster_width == 0 || batch->poster_height == 0)
+        {
+            printf("Invalid poster size %s %s, expected <width> <height>\n", values[0], values[1]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(strcmp(name, "pyramid") == 0)
+    {
+        snprintf(batch->pyramid, sizeof(batch->pyramid), "%s", values[0]);
+        return 0;
+    }
+
+    if(strcmp(name, "script") == 0) return batch_script(batch, values[0]);
+
+    if(strcmp(name, "save-timeline") == 0)
+    {
+        snprintf(batch->save, sizeof(batch->save), "%s", values[0]);
+        return 0;
+    }
+
+    if(strcmp(name, "timeline") == 0)
+    {
+        Timeline* loaded = timeline_load(values[0]);
+        if(loaded == NULL) return -1;
+
+        //The first timeline is used in place, mapped. Keyframes after it are copied onto the end
+        if(batch->timeline->npanels == 0)
+        {
+            deleteTimeline(batch->timeline);
+            batch->timeline = loaded;
+            return 0;
+        }
+
+        for(int i = 0; i < loaded->npanels; i++)
+        {
+            const Panel* panel = &loaded->panels[i];
+            timeline_insert(batch->timeline, batch->timeline->npanels, panel->max, panel->mid, panel->duration, NULL);
+        }
+
+        deleteTimeline(loaded);
+        return 0;
+    }
+
+    //A keyframe
+    Coord mid, max;
+    int duration;
+
+    if(!parse_coordinate(values[0], &mid.real) || !parse_coordinate(values[1], &mid.imag) || !parse_coordinate(values[2], &max.real) || max.real == 0 || !parse_int(values[3], &duration))
+    {
+        printf("Invalid keyframe %s %s %s %s, expected <real> <imag> <max> <seconds>\n", values[0], values[1], values[2], values[3]);
+        return -1;
+    }
+
+    //The gif is square
+    max.imag = max.real;
+
+    timeline_insert(batch->timeline, batch->timeline->npanels, max, mid, duration, NULL);
+    return 0;
+}
+
+/*
+    APPLIES a list of settings to batch. RETURNS 0 on success, -1 after printing why it is invalid
+
+    \param words The names and values of the settings in order
+    \param nwords The number of words
+    \param dashes Whether every name starts with "--", as on the command line
+*/
+static int batch_settings(Batch* batch, char** words, int nwords, int dashes)
+{
+    int i = 0;
+
+    while(i < nwords)
+    {
+        const char* name = words[i];
+
+        if(dashes)
+        {
+            if(strncmp(name, "--", 2) != 0)
+            {
+                printf("Expected a setting starting with --, got %s\n", name);
+                return -1;
+            }
+            name += 2;
+        }
+
+        int nvalues = batch_values(name);
+
+        if(nvalues < 0 || (!dashes && strcmp(name, "script") == 0))
+        {
+            printf("Unknown setting %s\n", words[i]);
+            return -1;
+        }
+
+        if(i + nvalues >= nwords)
+        {
+            printf("%s needs %d value%s\n", words[i], nvalues, nvalues == 1 ? "" : "s");
+            return -1;
+        }
+
+        if(batch_setting(batch, name, words + i + 1) != 0) return -1;
+        i += nvalues + 1;
+    }
+
+    return 0;
+}
+
+//READS the settings in the script at path into batch. RETURNS 0 on success, -1 after printing why it failed
+static int batch_script(Batch* batch, const char* path)
+{
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        printf("Could not open %s\n", path);
+        return -1;
+    }
+
+    char line[BATCH_LINE];
+    int number = 0;
+    int result = 0;
+
+    while(result == 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        number++;
+
+        char* comment = strchr(line, '#');
+        if(comment != NULL) *comment = '\0';
+
+        //Words past the values of a setting are read as the next setting, and rejected
+        char* words[BATCH_WORDS];
+        int nwords = 0;
+
+        for(char* word = strtok(line, " \t\r\n"); word != NULL && nwords < BATCH_WORDS; word = strtok(NULL, " \t\r\n")) words[nwords++] = word;
+
+        if(nwords > 0 && batch_settings(batch, words, nwords, 0) != 0)
+        {
+            printf("In line %d of %s\n", number, path);
+            result = -1;
+        }
+    }
+
+    fclose(file);
+    return result;
+}
+
+int run_batch(const char* program, int argc, char** argv)
+{
+    Batch batch;
+    batch.output[0] = '\0';
+    batch.trace[0] = '\0';
+    batch.size = BATCH_SIZE;
+    batch.mode = RENDER_BRUTE_FORCE;
+    batch.shards = 1;
+    batch.shard = -1;
+    batch.merge = 0;
+    batch.checkpoint = -1;
+    batch.threads = 0;
+    batch.cache = 1;
+    batch.quiet = 0;
+    batch.poster_width = 0;
+    batch.poster_height = 0;
+    batch.pyramid[0] = '\0';
+    batch.timeline = newTimeline();
+    batch.save[0] = '\0';
+
+    int status = 1;
+    int valid = batch_settings(&batch, argv, argc, 1) == 0;
+
+    if(valid && batch.timeline->npanels == 0)
+    {
+        printf("No keyframes given, use --key <real> <imag> <max> <seconds> or --timeline <path>\n");
+        valid = 0;
+    }
+
+    //Saving the keyframes is enough on its own
+    if(valid && batch.save[0] != '\0')
+    {
+        if(timeline_save(batch.timeline, batch.save) == 0) printf("%d keyframes saved to %s\n", batch.timeline->npanels, batch.save);
+        else
+        {
+            printf("Could not write the timeline to %s\n", batch.save);
+            valid = 0;
+        }
+
+        if(valid && batch.output[0] == '\0')
+        {
+            deleteTimeline(batch.timeline);
+            return 0;
+        }
+    }
+
+    if(valid && batch.output[0] == '\0')
+    {
+        printf("No output given, use --output <path>\n");
+        valid = 0;
+    }
+
+    if(valid && batch.shard >= batch.shards)
+    {
+        printf("Shard %d is not below the %d shards, which are counted from 0\n", batch.shard, batch.shards);
+        valid = 0;
+    }
+
+    if(valid && batch.merge && batch.shard >= 0)
+    {
+        printf("A shard is either rendered or merged, not both\n");
+        valid = 0;
+    }
+
+    if(valid)
+    {
+        Pool* p_pool = newPool(batch.threads);
+        Cache* p_cache = batch.cache ? newCache(0) : NULL;
+
+        Gif_Options options = gif_default_options();
+        options.mode = batch.mode;
+        options.cache = p_cache;
+        options.progress = !batch.quiet;
+        options.shards = batch.shards;
+        options.program = program;
+        if(batch.trace[0] != '\0') options.trace = batch.trace;
+        if(batch.checkpoint >= 0) options.checkpoint = batch.checkpoint;
+
+        int result;
+
+        if(batch.poster_width > 0)
+        {
+            //The keyframe's max is half its width, the height follows from the shape of the poster
+            Coord max = batch.timeline->panels[0].max, mid = batch.timeline->panels[0].mid;
+            max.imag = max.real * batch.poster_height / batch.poster_width;
+
+            Poster_Options poster_options = poster_default_options();
+            poster_options.mode = batch.mode;
+            poster_options.pyramid = batch.pyramid;
+            poster_options.progress = !batch.quiet;
+
+            printf("Rendering a %dx%d poster to %s by %s on %d threads\n", batch.poster_width, batch.poster_height, batch.output, render_mode_name(batch.mode), pool_size(p_pool));
+            result = save_poster(batch.output, batch.poster_width, batch.poster_height, max, mid, p_pool, poster_options);
+        }
+        else if(batch.merge) result = merge_shards(batch.output, batch.size, batch.timeline, options, batch.shards);
+        else if(batch.shard >= 0)
+        {
+            printf("Rendering shard %d of %d of %s at %dx%d by %s on %d threads\n", batch.shard, batch.shards, batch.output, batch.size, batch.size, render_mode_name(batch.mode), pool_size(p_pool));
+            result = render_shard(batch.output, batch.size, batch.timeline, p_pool, options, batch.shard, batch.shards);
+        }
+        else
+        {
+            printf("Rendering %d keyframes to %s at %dx%d by %s on %d threads\n", batch.timeline->npanels, batch.output, batch.size, batch.size, render_mode_name(batch.mode), pool_size(p_pool));
+            result = save_gif(batch.output, batch.size, batch.timeline, p_pool, options);
+        }
+
+        if(result == 0) status = 0;
+
+        if(p_cache != NULL) deleteCache(p_cache);
+        deletePool(p_pool);
+    }
+
+    deleteTimeline(batch.timeline);
+
+    return status;
+}
@@ -0,0 +1,46 @@
+#ifndef _BATCH
+#define _BATCH
+
+//Renders gifs and posters without a window or the menu, from keyframes given on the command line or in a script
+
+#include "helper.h"
+
+/*
+    RENDERS the gif (or poster) described by a list of settings and RETURNS the exit status of the program,
+    0 if it was written and 1 otherwise. Every setting is a name followed by its values, and
+    may be given on the command line with a leading "--" or one to a line in a script ('#' starts a comment)
+
+    output <path>                       Where the gif is written (required unless saving a timeline)
+    size <pixels>                       The sidelength of the gif, 480 by default and at most GIF_MAX_SIZE
+    mode <brute|subdivide|progressive>  How the pixels of each frame are found, brute by default
+    trace <path>                        Writes where each frame's time went, as Chrome trace JSON if path
+                                        ends in .json and CSV otherwise (see Gif_Options)
+    key <real> <imag> <max> <seconds>   Adds a keyframe centred on (real, imag), max away from its edges,
+                                        taking seconds to reach the next one. At least one keyframe is required
+    timeline <path>                     Adds the keyframes of a timeline file (see timeline_save) after those
+                                        given so far. A timeline given first is mapped rather than read
+    save-timeline <path>                Saves every keyframe given to a timeline file. With no output, the
+                                        keyframes are only saved, eg to turn a long script into a timeline
+    shards <n>                          Splits the frames between n processes, 1 by default. A shard that
+                                        failed is resumed by running the same settings again
+    shard <k>                           Renders only the fragment of shard k (from 0) of the n, eg on another
+                                        machine sharing the filesystem
+    merge                               Only joins the fragments of the n shards into the output
+    checkpoint <seconds>                Records how far the gif got every so many seconds, so running the
+                                        same settings again after it was stopped resumes it (see save_gif).
+                                        0 for none, the default unless FRACTAL_CHECKPOINT is set
+    poster <width> <height>             Renders a still of the first keyframe instead, a band at a time, as
+                                        .ppm, .pgm or .raw by the extension of the output (see save_poster)
+    pyramid <path>                      Also writes a Deep Zoom pyramid of the poster, eg poster.dzi
+    threads <n>                         Renders on n threads, FRACTAL_THREADS or one per cpu by default
+    no-cache                            Iterates every frame in full rather than sharing tiles between them
+    quiet                               Draws no progress line
+    script <path>                       Reads more settings from a file (command line only)
+
+    \param program The path the program was started by, argv[0], which shards are started from (see Gif_Options)
+    \param argc The number of arguments, not counting the name of the program
+    \param argv The arguments, not counting the name of the program
+*/
+int run_batch(const char* program, int argc, char** argv);
+
+#endif // #ifndef _BATCH
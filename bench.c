@@ -0,0 +1,324 @@
+/*
+
+Benchmarks of the renderer on fixed views, for tracking its speed across builds.
+
+Usage: fractals_bench [--repeats <n>] [--csv <path>]
+
+Each workload is timed over n runs after one to warm up. The min, median and 95th percentile are printed,
+with megapixels, iterations and frames per second at the median. --csv also writes them to a file, one
+line per workload. The iterations of save_gif are not counted, its frames never leave export.c
+
+*/
+
+#include "helper.h"
+#include "gifenc.h"
+#include "escape.h"
+#include "frame.h"
+#include "export.h"
+
+#include <string.h>
+#include <time.h>
+
+//The sidelength of every benchmarked frame
+#define BENCH_SIZE 480
+
+//The sidelength of the frames of the benchmarked gif
+#define BENCH_GIF_SIZE 240
+
+//Times each workload is run when --repeats is not given, after one run to warm up
+#define BENCH_REPEATS 5
+
+//Where the benchmarked gif is written, removed afterwards
+#define BENCH_GIF "fractals_bench.gif"
+
+//A fixed view, as strings so the deep one keeps every digit strtold can
+typedef struct Bench_View
+{
+    const char* name;
+    const char* real;
+    const char* imag;
+    const char* max;
+} Bench_View;
+
+static const Bench_View views[] = {
+    {"full_set", "-0.75", "0", "1.5"},
+    {"seahorse", "-0.743643887037151", "0.13182590420533", "0.005"},
+    {"deep_zoom", "-0.743643887037158704752191506114774", "0.131825904205311970493132056385139", "1e-20"}
+};
+
+#define NVIEWS ((int) (sizeof(views) / sizeof(views[0])))
+
+//How a workload is run
+typedef enum Bench_Kind
+{
+    BENCH_KERNEL, //The escape kernels on every row of a view, on one thread
+    BENCH_FRAME, //render_frame over the pool, as the viewer does
+    BENCH_FRAME_SUBDIVIDE, //The same by Mariani-Silver subdivision
+    BENCH_GIF_FRAME, //gif_render and ge_add_frame of a single frame into memory
+    BENCH_SAVE_GIF //save_gif of a short path between the views, to a file
+} Bench_Kind;
+
+//One workload and what one run of it does
+typedef struct Bench_Case
+{
+    char name[64];
+    Bench_Kind kind;
+    const Bench_View* view;
+
+    long pixels;
+    long iterations; //Escape counts summed, points in the set counted as BASE_ITERATIONS
+    int frames;
+} Bench_Case;
+
+//Everything the workloads share
+typedef struct Bench
+{
+    Pool* pool;
+    Iter_Buffer* counts;
+    Timeline* path;
+} Bench;
+
+//RETURN a monotonic time in seconds
+static double seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+//FINDS the centre and largest coordinate of view
+static void view_coords(const Bench_View* view, Coord* p_max, Coord* p_mid)
+{
+    p_mid->real = strtold(view->real, NULL);
+    p_mid->imag = strtold(view->imag, NULL);
+    p_max->real = p_max->imag = strtold(view->max, NULL);
+}
+
+//RETURN the iterations the escape counts of a frame stand for
+static long count_iterations(const uint16_t* iters, long pixels)
+{
+    long total = 0;
+    for(long i = 0; i < pixels; i++) total += iters[i] == 0 ? BASE_ITERATIONS : iters[i];
+    return total;
+}
+
+//RUNS the escape kernels on every row of a view, the way render_frame would with no pool
+static void run_kernel(Bench* bench, Coord max, Coord mid)
+{
+    Precision precision = frame_precision(BENCH_SIZE, BENCH_SIZE, max, mid);
+    long double scale = 2 * max.real / BENCH_SIZE;
+
+    for(int y = 0; y < BENCH_SIZE; y++)
+    {
+        Coord offset;
+        offset.real = -max.real;
+        offset.imag = y * scale - max.imag;
+        escape_row(bench->counts->iters + (long) y * BENCH_SIZE, BENCH_SIZE, mid, offset, scale, 0, precision, BASE_ITERATIONS);
+    }
+}
+
+//RUNS gif_render on a view and encodes it as the only frame of a gif in memory
+static void run_gif_frame(Bench* bench, Coord max, Coord mid)
+{
+    uint8_t palette[PALETTE_SIZE * 3] = {0};
+    uint8_t lut[MAX_ITERATIONS + 1];
+    palette_lut(lut);
+
+    ge_Sink* sink = ge_sink_memory();
+    ge_GIF* gif = ge_new_gif(sink, BENCH_SIZE, BENCH_SIZE, palette, PALETTE_DEPTH, -1, 0);
+
+    gif_render(bench->counts, bench->pool, NULL, max, mid, RENDER_BRUTE_FORCE);
+
+    for(long pixel = 0; pixel < (long) BENCH_SIZE * BENCH_SIZE; pixel++) gif->frame[pixel] = lut[bench->counts->iters[pixel]];
+    ge_add_frame(gif, 1);
+
+    ge_close_gif(gif);
+    ge_sink_close(sink);
+}
+
+//RUNS one workload once. RETURNS the seconds it took
+static double run_case(Bench* bench, Bench_Case* bench_case)
+{
+    Coord max, mid;
+    if(bench_case->view != NULL) view_coords(bench_case->view, &max, &mid);
+
+    double start = seconds();
+
+    switch(bench_case->kind)
+    {
+        case BENCH_KERNEL:
+            run_kernel(bench, max, mid);
+            break;
+
+        case BENCH_FRAME:
+            render_frame(bench->pool, NULL, bench->counts->iters, BENCH_SIZE, BENCH_SIZE, max, mid, RENDER_BRUTE_FORCE);
+            break;
+
+        case BENCH_FRAME_SUBDIVIDE:
+            render_frame(bench->pool, NULL, bench->counts->iters, BENCH_SIZE, BENCH_SIZE, max, mid, RENDER_SUBDIVIDE);
+            break;
+
+        case BENCH_GIF_FRAME:
+            run_gif_frame(bench, max, mid);
+            break;
+
+        case BENCH_SAVE_GIF:
+        {
+            Gif_Options options = gif_default_options();
+            options.progress = 0;
+            options.trace = NULL;
+            save_gif(BENCH_GIF, BENCH_GIF_SIZE, bench->path, bench->pool, options);
+            break;
+        }
+    }
+
+    double elapsed = seconds() - start;
+
+    //The work a run does is fixed, so it is counted from the first run's output
+    if(bench_case->kind == BENCH_SAVE_GIF)
+    {
+        bench_case->frames = timeline_frames(bench->path);
+        bench_case->pixels = (long) bench_case->frames * BENCH_GIF_SIZE * BENCH_GIF_SIZE;
+        bench_case->iterations = 0;
+    }
+    else
+    {
+        bench_case->frames = 1;
+        bench_case->pixels = (long) BENCH_SIZE * BENCH_SIZE;
+        bench_case->iterations = count_iterations(bench->counts->iters, bench_case->pixels);
+    }
+
+    return elapsed;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+//RETURN the value below which fraction of the sorted times lie, by nearest rank
+static double percentile(const double* sorted, int count, double fraction)
+{
+    int rank = (int) ceil(fraction * count);
+    return sorted[rank < 1 ? 0 : rank - 1];
+}
+
+//RETURN the number of workloads, filling cases with them if it is not NULL
+static int list_cases(Bench_Case* cases)
+{
+    int count = 0;
+    Bench_Kind per_view[] = {BENCH_KERNEL, BENCH_FRAME, BENCH_FRAME_SUBDIVIDE, BENCH_GIF_FRAME};
+    const char* prefixes[] = {"kernel", "frame", "frame_subdivide", "gif_frame"};
+
+    for(int kind = 0; kind < 4; kind++)
+    {
+        for(int view = 0; view < NVIEWS; view++)
+        {
+            if(cases != NULL)
+            {
+                snprintf(cases[count].name, sizeof(cases[count].name), "%s/%s", prefixes[kind], views[view].name);
+                cases[count].kind = per_view[kind];
+                cases[count].view = &views[view];
+            }
+            count++;
+        }
+    }
+
+    if(cases != NULL)
+    {
+        snprintf(cases[count].name, sizeof(cases[count].name), "save_gif/full_to_seahorse");
+        cases[count].kind = BENCH_SAVE_GIF;
+        cases[count].view = NULL;
+    }
+    count++;
+
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = BENCH_REPEATS;
+    const char* csv_path = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--repeats") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) repeats = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csv_path = argv[++i];
+        else
+        {
+            printf("Usage: %s [--repeats <n>] [--csv <path>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* csv = NULL;
+    if(csv_path != NULL)
+    {
+        csv = fopen(csv_path, "w");
+        if(csv == NULL)
+        {
+            printf("Could not create %s\n", csv_path);
+            return 1;
+        }
+        fprintf(csv, "case,isa,threads,repeats,pixels,iterations,frames,min_s,median_s,p95_s,mpixels_per_s,miterations_per_s,frames_per_s\n");
+    }
+
+    Bench bench;
+    bench.pool = newPool(0);
+    bench.counts = newIterBuffer(BENCH_SIZE, BENCH_SIZE);
+
+    //A one second zoom from the full set to seahorse valley
+    Coord max, mid;
+    view_coords(&views[0], &max, &mid);
+    bench.path = newTimeline();
+    timeline_insert(bench.path, 0, max, mid, 1, NULL);
+    view_coords(&views[1], &max, &mid);
+    timeline_insert(bench.path, 1, max, mid, 1, NULL);
+
+    int ncases = list_cases(NULL);
+    Bench_Case* cases = (Bench_Case*) malloc(ncases * sizeof(Bench_Case));
+    list_cases(cases);
+
+    double* times = (double*) malloc(repeats * sizeof(double));
+
+    printf("Escape kernel: %s, %d threads, %d repeats, %dx%d frames\n", escape_isa(), pool_size(bench.pool), repeats, BENCH_SIZE, BENCH_SIZE);
+
+    for(int c = 0; c < ncases; c++)
+    {
+        run_case(&bench, &cases[c]);
+        for(int r = 0; r < repeats; r++) times[r] = run_case(&bench, &cases[c]);
+
+        qsort(times, repeats, sizeof(double), compare_doubles);
+
+        double median = repeats % 2 ? times[repeats / 2] : (times[repeats / 2 - 1] + times[repeats / 2]) / 2;
+        double p95 = percentile(times, repeats, 0.95);
+
+        //Throughput is taken at the median, the least disturbed by outliers
+        double mpixels = cases[c].pixels / median * 1e-6;
+        double miterations = cases[c].iterations / median * 1e-6;
+        double fps = cases[c].frames / median;
+
+        printf("%-28s min %9.2fms  median %9.2fms  p95 %9.2fms  %9.2f MP/s  %10.1f Miter/s  %8.2f fps\n",
+               cases[c].name, times[0] * 1e3, median * 1e3, p95 * 1e3, mpixels, miterations, fps);
+
+        if(csv != NULL)
+        {
+            fprintf(csv, "%s,%s,%d,%d,%ld,%ld,%d,%.9f,%.9f,%.9f,%.4f,%.4f,%.4f\n",
+                    cases[c].name, escape_isa(), pool_size(bench.pool), repeats, cases[c].pixels, cases[c].iterations,
+                    cases[c].frames, times[0], median, p95, mpixels, miterations, fps);
+        }
+    }
+
+    remove(BENCH_GIF);
+
+    if(csv != NULL) fclose(csv);
+
+    free(times);
+    free(cases);
+    deleteIterBuffer(bench.counts);
+    deleteTimeline(bench.path);
+    deletePool(bench.pool);
+
+    return 0;
+}
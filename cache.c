@@ -0,0 +1,403 @@
+#include "cache.h"
+
+#include <pthread.h>
+#include <string.h>
+
+//How the counts of a tile are stored
+enum
+{
+    CACHE_RAW8, //One byte per count
+    CACHE_RAW16, //Two bytes per count
+    CACHE_RLE8, //Runs of (count, length) with one byte each
+    CACHE_RLE16 //Runs of (count, length) with two bytes each
+};
+
+//Each bucket is this many entries on average before the table doubles
+#define CACHE_LOAD 2
+
+typedef struct Cache_Entry
+{
+    Tile_Key key;
+    struct Cache_Entry* next; //The next entry in the same bucket
+
+    //Neighbours in the order of use, the most recent at the head of the cache
+    struct Cache_Entry* newer;
+    struct Cache_Entry* older;
+
+    int format;
+    int size;
+    long length; //Bytes in data
+    uint8_t data[];
+} Cache_Entry;
+
+struct Cache
+{
+    //Guards everything below
+    pthread_mutex_t lock;
+
+    Cache_Entry** buckets;
+    long nbuckets;
+
+    Cache_Entry* newest;
+    Cache_Entry* oldest;
+
+    long cap;
+    Cache_Stats stats;
+};
+
+//RETURN the bucket of key, out of nbuckets (a power of 2)
+static long bucket(Tile_Key key, long nbuckets)
+{
+    //The padding of a long double is never read, the hash goes through a double instead
+    double scale[2] = {(double) key.scale_real, (double) key.scale_imag};
+    uint64_t words[2];
+    memcpy(words, scale, sizeof(words));
+
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t parts[5] = {words[0], words[1], (uint64_t) key.x, (uint64_t) key.y, (uint64_t) key.variant};
+
+    for(int i = 0; i < 5; i++)
+    {
+        hash ^= parts[i];
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+
+    return (long) (hash & (uint64_t) (nbuckets - 1));
+}
+
+static int same_key(Tile_Key a, Tile_Key b)
+{
+    return a.scale_real == b.scale_real && a.scale_imag == b.scale_imag && a.x == b.x && a.y == b.y && a.variant == b.variant;
+}
+
+//MOVES entry to the head of the order of use, entry must not be in it
+static void push_newest(Cache* cache, Cache_Entry* entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if(cache->newest != NULL) cache->newest->newer = entry;
+    cache->newest = entry;
+    if(cache->oldest == NULL) cache->oldest = entry;
+}
+
+//TAKES entry out of the order of use
+static void unlink_use(Cache* cache, Cache_Entry* entry)
+{
+    if(entry->newer != NULL) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+
+    if(entry->older != NULL) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+}
+
+//TAKES entry out of its bucket
+static void unlink_bucket(Cache* cache, Cache_Entry* entry)
+{
+    Cache_Entry** link = &cache->buckets[bucket(entry->key, cache->nbuckets)];
+    while(*link != entry) link = &(*link)->next;
+    *link = entry->next;
+}
+
+//RETURN the entry stored under key, or NULL
+static Cache_Entry* find(Cache* cache, Tile_Key key)
+{
+    Cache_Entry* entry = cache->buckets[bucket(key, cache->nbuckets)];
+    while(entry != NULL && !same_key(entry->key, key)) entry = entry->next;
+    return entry;
+}
+
+//DOUBLES the number of buckets
+static void grow(Cache* cache)
+{
+    long nbuckets = cache->nbuckets * 2;
+    Cache_Entry** buckets = (Cache_Entry**) calloc(nbuckets, sizeof(Cache_Entry*));
+
+    for(long i = 0; i < cache->nbuckets; i++)
+    {
+        Cache_Entry* entry = cache->buckets[i];
+        while(entry != NULL)
+        {
+            Cache_Entry* next = entry->next;
+            long index = bucket(entry->key, nbuckets);
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->nbuckets = nbuckets;
+}
+
+//----------------------------------//
+
+/*
+    RETURNS a new entry holding the tile in whichever format is smallest
+
+    \param tile The counts, size rows of size counts, stride counts apart
+*/
+static Cache_Entry* encode(Tile_Key key, const uint16_t* tile, int stride, int size)
+{
+    uint16_t largest = 0;
+    long runs = 0;
+    uint16_t previous = 0;
+    long run = 0;
+    int wide_runs = 0;
+
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < size; x++)
+        {
+            uint16_t count = tile[(long) y * stride + x];
+            if(count > largest) largest = count;
+
+            if(run > 0 && count == previous && run < 0xFFFF) run++;
+            else
+            {
+                runs++;
+                run = 1;
+                previous = count;
+            }
+            if(run > 0xFF) wide_runs = 1;
+        }
+    }
+
+    int wide = largest > 0xFF;
+    long raw = (long) size * size * (wide ? 2 : 1);
+
+    //Short runs in single bytes would need splitting, so they are only used when every run fits
+    int rle_wide = wide || wide_runs;
+    long rle = runs * (rle_wide ? 4 : 2);
+
+    int format = rle < raw ? (rle_wide ? CACHE_RLE16 : CACHE_RLE8) : (wide ? CACHE_RAW16 : CACHE_RAW8);
+    long length = rle < raw ? rle : raw;
+
+    Cache_Entry* entry = (Cache_Entry*) malloc(sizeof(Cache_Entry) + length);
+    entry->key = key;
+    entry->format = format;
+    entry->size = size;
+    entry->length = length;
+
+    uint8_t* data = entry->data;
+    run = 0;
+
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < size; x++)
+        {
+            uint16_t count = tile[(long) y * stride + x];
+
+            if(format == CACHE_RAW8) *data++ = (uint8_t) count;
+            else if(format == CACHE_RAW16)
+            {
+                memcpy(data, &count, 2);
+                data += 2;
+            }
+            else
+            {
+                //The run being built is written out once the next count breaks it
+                if(run > 0 && count == previous && run < 0xFFFF)
+                {
+                    run++;
+                    continue;
+                }
+
+                if(run > 0)
+                {
+                    if(format == CACHE_RLE8)
+                    {
+                        *data++ = (uint8_t) previous;
+                        *data++ = (uint8_t) run;
+                    }
+                    else
+                    {
+                        uint16_t pair[2] = {previous, (uint16_t) run};
+                        memcpy(data, pair, 4);
+                        data += 4;
+                    }
+                }
+                previous = count;
+                run = 1;
+            }
+        }
+    }
+
+    if(run > 0 && format == CACHE_RLE8)
+    {
+        *data++ = (uint8_t) previous;
+        *data++ = (uint8_t) run;
+    }
+    else if(run > 0 && format == CACHE_RLE16)
+    {
+        uint16_t pair[2] = {previous, (uint16_t) run};
+        memcpy(data, pair, 4);
+    }
+
+    return entry;
+}
+
+//COPIES the counts of entry into out, stride counts apart
+static void decode(const Cache_Entry* entry, uint16_t* out, int stride)
+{
+    int size = entry->size;
+    const uint8_t* data = entry->data;
+
+    if(entry->format == CACHE_RAW8 || entry->format == CACHE_RAW16)
+    {
+        for(int y = 0; y < size; y++)
+        {
+            uint16_t* row = out + (long) y * stride;
+            for(int x = 0; x < size; x++)
+            {
+                if(entry->format == CACHE_RAW8) row[x] = *data++;
+                else
+                {
+                    memcpy(&row[x], data, 2);
+                    data += 2;
+                }
+            }
+        }
+        return;
+    }
+
+    int x = 0, y = 0;
+    const uint8_t* end = data + entry->length;
+
+    while(data < end)
+    {
+        uint16_t count, run;
+
+        if(entry->format == CACHE_RLE8)
+        {
+            count = data[0];
+            run = data[1];
+            data += 2;
+        }
+        else
+        {
+            uint16_t pair[2];
+            memcpy(pair, data, 4);
+            count = pair[0];
+            run = pair[1];
+            data += 4;
+        }
+
+        for(; run > 0; run--)
+        {
+            out[(long) y * stride + x] = count;
+            if(++x == size)
+            {
+                x = 0;
+                y++;
+            }
+        }
+    }
+}
+
+//----------------------------------//
+
+long cache_default_bytes()
+{
+    char* env = getenv(CACHE_ENV);
+    long megabytes = env != NULL && atol(env) > 0 ? atol(env) : CACHE_DEFAULT_MB;
+    return megabytes << 20;
+}
+
+Cache* newCache(long bytes)
+{
+    Cache* cache = (Cache*) calloc(1, sizeof(Cache));
+    cache->cap = bytes > 0 ? bytes : cache_default_bytes();
+    cache->nbuckets = 256;
+    cache->buckets = (Cache_Entry**) calloc(cache->nbuckets, sizeof(Cache_Entry*));
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+int cache_get(Cache* cache, Tile_Key key, uint16_t* out, int stride, int size)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    Cache_Entry* entry = find(cache, key);
+
+    if(entry == NULL || entry->size != size)
+    {
+        cache->stats.misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+
+    cache->stats.hits++;
+    unlink_use(cache, entry);
+    push_newest(cache, entry);
+
+    //Decoded under the lock, so the entry cannot be evicted halfway through
+    decode(entry, out, stride);
+
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+}
+
+void cache_put(Cache* cache, Tile_Key key, const uint16_t* tile, int stride, int size)
+{
+    //Compacted outside the lock, as the only slow part
+    Cache_Entry* entry = encode(key, tile, stride, size);
+    long bytes = sizeof(Cache_Entry) + entry->length;
+
+    pthread_mutex_lock(&cache->lock);
+
+    //Another thread got there first
+    if(bytes > cache->cap || find(cache, key) != NULL)
+    {
+        pthread_mutex_unlock(&cache->lock);
+        free(entry);
+        return;
+    }
+
+    while(cache->stats.bytes + bytes > cache->cap)
+    {
+        Cache_Entry* oldest = cache->oldest;
+        unlink_use(cache, oldest);
+        unlink_bucket(cache, oldest);
+        cache->stats.bytes -= sizeof(Cache_Entry) + oldest->length;
+        cache->stats.tiles--;
+        cache->stats.evictions++;
+        free(oldest);
+    }
+
+    long index = bucket(key, cache->nbuckets);
+    entry->next = cache->buckets[index];
+    cache->buckets[index] = entry;
+    push_newest(cache, entry);
+
+    cache->stats.bytes += bytes;
+    cache->stats.tiles++;
+
+    if(cache->stats.tiles > cache->nbuckets * CACHE_LOAD) grow(cache);
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+Cache_Stats cache_stats(Cache* cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    Cache_Stats stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+    return stats;
+}
+
+void deleteCache(Cache* cache)
+{
+    Cache_Entry* entry = cache->newest;
+    while(entry != NULL)
+    {
+        Cache_Entry* older = entry->older;
+        free(entry);
+        entry = older;
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
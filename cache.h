@@ -0,0 +1,78 @@
+#ifndef _CACHE
+#define _CACHE
+
+//A least-recently-used cache of rendered tiles of escape counts, shared by the viewer and the gif export
+
+#include "helper.h"
+
+//Environment variable which sets the most memory the cache may use, in megabytes
+#define CACHE_ENV "FRACTAL_CACHE_MB"
+
+//The memory cap used when CACHE_ENV is not set, in megabytes
+#define CACHE_DEFAULT_MB 64
+
+//Everything the counts of a tile depend on. A tile is only ever handed back for the same key
+typedef struct Tile_Key
+{
+    //The pixel spacing of the view, one level of the quadtree per spacing
+    long double scale_real;
+    long double scale_imag;
+
+    //The position of the tile, counted in tiles from the origin
+    long long x;
+    long long y;
+
+    //Anything else that changes the counts, eg the precision and render mode
+    int variant;
+} Tile_Key;
+
+//Counters of what the cache did since it was made
+typedef struct Cache_Stats
+{
+    long hits;
+    long misses;
+    long evictions;
+    long tiles; //Tiles held now
+    long bytes; //Memory they take up now
+} Cache_Stats;
+
+typedef struct Cache Cache;
+
+//RETURN an empty cache which holds at most bytes of tiles. bytes <= 0 uses cache_default_bytes()
+Cache* newCache(long bytes);
+
+//RETURN the memory cap set by CACHE_ENV, or CACHE_DEFAULT_MB if it is not set
+long cache_default_bytes();
+
+/*
+    COPIES the tile stored under key into out. RETURNS 1 on a hit, 0 if there is no such tile.
+    Safe to call from several threads at once
+
+    \param cache The cache being searched
+    \param key What the tile was rendered from
+    \param out Where the counts are copied, size rows of size counts, stride counts apart
+    \param stride The distance between the rows of out, eg the width of the frame
+    \param size The sidelength of the tile
+*/
+int cache_get(Cache* cache, Tile_Key key, uint16_t* out, int stride, int size);
+
+/*
+    STORES a copy of a tile under key, compacted to bytes when the counts fit and run-length encoded when
+    that is smaller. The least recently used tiles are dropped to stay under the memory cap.
+    Safe to call from several threads at once
+
+    \param cache The cache the tile is stored in
+    \param key What the tile was rendered from
+    \param tile The counts, size rows of size counts, stride counts apart
+    \param stride The distance between the rows of tile
+    \param size The sidelength of the tile
+*/
+void cache_put(Cache* cache, Tile_Key key, const uint16_t* tile, int stride, int size);
+
+//RETURN the counters of cache
+Cache_Stats cache_stats(Cache* cache);
+
+//FREES the cache and every tile in it
+void deleteCache(Cache* cache);
+
+#endif // #ifndef _CACHE
@@ -0,0 +1,179 @@
+#include "deep.h"
+
+//The precision the reference orbit is iterated in
+#ifdef __SIZEOF_FLOAT128__
+typedef __float128 Deep_Float;
+#else
+typedef long double Deep_Float;
+#endif
+
+//The series is stopped once the terms it drops could move a pixel by this fraction of a pixel
+#define SERIES_TOLERANCE 1e-6
+
+//The series is stopped before its coefficients can overflow a double
+#define SERIES_LIMIT 1e200
+
+//RETURN the magnitude of the complex number (real, imag)
+static double magnitude(double real, double imag)
+{
+    return sqrt(real * real + imag * imag);
+}
+
+/*
+    FINDS how many iterations the series approximation lets every pixel skip, and the coefficients there.
+    The series is only trusted while the terms it drops stay far below a pixel, and while no pixel could
+    have escaped during the skipped iterations.
+*/
+static void series(Orbit* orbit, Coord max, long double step)
+{
+    double radius = magnitude((double) max.real, (double) max.imag);
+
+    //dz_1 = dc
+    double a_real = 1, a_imag = 0;
+    double b_real = 0, b_imag = 0;
+    double c_real = 0, c_imag = 0;
+
+    for(int n = 1; n + 1 < orbit->length; n++)
+    {
+        double z_real = orbit->real[n], z_imag = orbit->imag[n];
+
+        //A' = 2ZA + 1, B' = 2ZB + A^2, C' = 2ZC + 2AB
+        double next_a_real = 2 * (z_real * a_real - z_imag * a_imag) + 1;
+        double next_a_imag = 2 * (z_real * a_imag + z_imag * a_real);
+        double next_b_real = 2 * (z_real * b_real - z_imag * b_imag) + a_real * a_real - a_imag * a_imag;
+        double next_b_imag = 2 * (z_real * b_imag + z_imag * b_real) + 2 * a_real * a_imag;
+        double next_c_real = 2 * (z_real * c_real - z_imag * c_imag) + 2 * (a_real * b_real - a_imag * b_imag);
+        double next_c_imag = 2 * (z_real * c_imag + z_imag * c_real) + 2 * (a_real * b_imag + a_imag * b_real);
+
+        double a = magnitude(next_a_real, next_a_imag);
+        double b = magnitude(next_b_real, next_b_imag);
+        double c = magnitude(next_c_real, next_c_imag);
+
+        if(!(a < SERIES_LIMIT && b < SERIES_LIMIT && c < SERIES_LIMIT)) break;
+        if(c * radius * radius * radius > SERIES_TOLERANCE * a * step) break;
+        if(magnitude(orbit->real[n + 1], orbit->imag[n + 1]) + a * radius + b * radius * radius + c * radius * radius * radius >= 2) break;
+
+        a_real = next_a_real; a_imag = next_a_imag;
+        b_real = next_b_real; b_imag = next_b_imag;
+        c_real = next_c_real; c_imag = next_c_imag;
+        orbit->skip = n + 1;
+    }
+
+    orbit->a[0] = a_real; orbit->a[1] = a_imag;
+    orbit->b[0] = b_real; orbit->b[1] = b_imag;
+    orbit->c[0] = c_real; orbit->c[1] = c_imag;
+}
+
+Orbit* newOrbit(Coord centre, Coord max, long double step, int max_iterations, int use_series)
+{
+    Orbit* orbit = (Orbit*) malloc(sizeof(Orbit));
+    orbit->real = (double*) malloc((max_iterations + 1) * sizeof(double));
+    orbit->imag = (double*) malloc((max_iterations + 1) * sizeof(double));
+    orbit->max_iterations = max_iterations;
+    orbit->skip = 0;
+
+    Deep_Float c_real = centre.real;
+    Deep_Float c_imag = centre.imag;
+    Deep_Float z_real = 0;
+    Deep_Float z_imag = 0;
+
+    orbit->real[0] = 0;
+    orbit->imag[0] = 0;
+
+    //The reference stops once it escapes, pixels still going are rebased when they reach its end
+    int n = 0;
+    while(n < max_iterations && z_real * z_real + z_imag * z_imag <= 4)
+    {
+        Deep_Float real2 = z_real * z_real;
+        Deep_Float imag2 = z_imag * z_imag;
+
+        z_imag = 2 * z_real * z_imag + c_imag;
+        z_real = real2 - imag2 + c_real;
+        n++;
+
+        orbit->real[n] = (double) z_real;
+        orbit->imag[n] = (double) z_imag;
+    }
+    orbit->length = n;
+
+    if(use_series) series(orbit, max, step);
+
+    return orbit;
+}
+
+void deleteOrbit(Orbit* orbit)
+{
+    free(orbit->real);
+    free(orbit->imag);
+    free(orbit);
+}
+
+//RETURN the escape count of the point dc away from the centre of orbit, 0 if it lasts budget iterations
+static uint16_t deep_point(const Orbit* orbit, double dc_real, double dc_imag, int budget)
+{
+    const double* ref_real = orbit->real;
+    const double* ref_imag = orbit->imag;
+
+    //The pixel's difference from the reference, and where it is along the reference
+    double dz_real = 0, dz_imag = 0;
+    int m = 0;
+    int i = 0;
+
+    if(orbit->skip > 0)
+    {
+        double dc2_real = dc_real * dc_real - dc_imag * dc_imag, dc2_imag = 2 * dc_real * dc_imag;
+        double dc3_real = dc2_real * dc_real - dc2_imag * dc_imag, dc3_imag = dc2_real * dc_imag + dc2_imag * dc_real;
+
+        dz_real = orbit->a[0] * dc_real - orbit->a[1] * dc_imag + orbit->b[0] * dc2_real - orbit->b[1] * dc2_imag + orbit->c[0] * dc3_real - orbit->c[1] * dc3_imag;
+        dz_imag = orbit->a[0] * dc_imag + orbit->a[1] * dc_real + orbit->b[0] * dc2_imag + orbit->b[1] * dc2_real + orbit->c[0] * dc3_imag + orbit->c[1] * dc3_real;
+        m = i = orbit->skip;
+    }
+
+    while(i < budget)
+    {
+        //dz' = (2Z + dz)dz + dc
+        double t_real = 2 * ref_real[m] + dz_real;
+        double t_imag = 2 * ref_imag[m] + dz_imag;
+        double next_real = t_real * dz_real - t_imag * dz_imag + dc_real;
+        dz_imag = t_real * dz_imag + t_imag * dz_real + dc_imag;
+        dz_real = next_real;
+        m++;
+        i++;
+
+        double z_real = ref_real[m] + dz_real;
+        double z_imag = ref_imag[m] + dz_imag;
+        double z2 = z_real * z_real + z_imag * z_imag;
+
+        if(z2 > 4) return i;
+
+        //Rebase: carry on from the start of the reference, where Z = 0
+        if(z2 < dz_real * dz_real + dz_imag * dz_imag || m == orbit->length)
+        {
+            dz_real = z_real;
+            dz_imag = z_imag;
+            m = 0;
+        }
+    }
+
+    return 0;
+}
+
+void deep_row(const Orbit* orbit, uint16_t* out, int count, Coord start, long double step, int first, int budget)
+{
+    double dc_imag = (double) start.imag;
+
+    for(int k = 0; k < count; k++)
+    {
+        out[k] = deep_point(orbit, (double) (start.real + (first + k) * step), dc_imag, budget);
+    }
+}
+
+void deep_pixels(const Orbit* orbit, uint16_t* iters, int width, int first_row, const int* pixels, int count, Coord start, Coord step, int budget)
+{
+    for(int k = 0; k < count; k++)
+    {
+        int x = pixels[k] % width;
+        int y = first_row + pixels[k] / width;
+        iters[pixels[k]] = deep_point(orbit, (double) (start.real + x * step.real), (double) (start.imag + y * step.imag), budget);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef _DEEP
+#define _DEEP
+
+/*
+    Perturbation deep-zoom engine. One reference orbit is iterated at high precision
+    from the centre of the view, and every pixel is iterated in doubles as a small
+    difference from it. This reaches pixel spacings far below what long double can
+    tell apart, at close to the speed of plain doubles.
+*/
+
+#include "helper.h"
+
+//The reference orbit of the centre of a view, shared by every pixel of the view
+typedef struct Orbit
+{
+    //The reference orbit as doubles, Z_0 = 0 up to Z_length
+    int length;
+    double* real;
+    double* imag;
+
+    //The series approximation: every pixel starts at iteration skip with
+    //dz = A dc + B dc^2 + C dc^3. skip is 0 when the series is not used
+    int skip;
+    double a[2];
+    double b[2];
+    double c[2];
+
+    int max_iterations;
+} Orbit;
+
+/*
+    RETURN the reference orbit of centre, iterated in the highest precision available (__float128 when the compiler has it)
+
+    \param centre The coordinate at the centre of the view, which the pixels are measured from
+    \param max The largest distance of a pixel from the centre along each axis
+    \param step The distance between neighbouring pixels (cartesian units/pixel)
+    \param max_iterations The most iterations any pixel will be given
+    \param use_series Whether to use series approximation to skip the first iterations
+*/
+Orbit* newOrbit(Coord centre, Coord max, long double step, int max_iterations, int use_series);
+
+//FREES an orbit
+void deleteOrbit(Orbit* orbit);
+
+/*
+    FILLS out with the escape counts of count points along a row, measured as offsets from the centre of orbit.
+    Point k is at offset start.real + (first + k) * step, start.imag. When a pixel's orbit gets closer to 0
+    than its difference from the reference (where the difference loses its precision, the cause of the usual
+    perturbation glitches) or the reference runs out, the pixel is rebased onto the start of the reference.
+
+    \param orbit The reference orbit of the view
+    \param out Where the escape counts are written, count entries long
+    \param count The number of points
+    \param start The offset from the centre of the leftmost point of the whole row
+    \param step The distance between neighbouring points (cartesian units/pixel)
+    \param first The index in the row of the first point
+    \param budget The number of iterations after which a point is considered to be in the set, at most orbit->max_iterations
+*/
+void deep_row(const Orbit* orbit, uint16_t* out, int count, Coord start, long double step, int first, int budget);
+
+/*
+    FILLS the listed pixels of iters with their escape counts, the same values deep_row gives them.
+    Pixel y * width + x is at offset start.real + x * step.real, start.imag + (first_row + y) * step.imag
+
+    \param orbit The reference orbit of the view
+    \param iters The escape counts of the whole view, or of a band of its rows, in row major order
+    \param width The width of the view in pixels
+    \param first_row The row of the view held in the first row of iters, 0 for a whole view
+    \param pixels The indices in iters of the pixels to fill
+    \param count The number of pixels
+    \param start The offset from the centre of the top left pixel of the view
+    \param step The distance between neighbouring pixels along each axis (cartesian units/pixel)
+    \param budget The number of iterations after which a point is considered to be in the set, at most orbit->max_iterations
+*/
+void deep_pixels(const Orbit* orbit, uint16_t* iters, int width, int first_row, const int* pixels, int count, Coord start, Coord step, int budget);
+
+#endif // #ifndef _DEEP
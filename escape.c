@@ -0,0 +1,805 @@
+#include "escape.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ESCAPE_X86
+#endif
+
+//Rows are converted to doubles and iterated this many points at a time
+#define ESCAPE_CHUNK 256
+
+//Chunks are padded with copies of their last point to a multiple of this, so short ones still fill the SIMD lanes
+#define ESCAPE_PAD 16
+
+/*
+    Defines name(real, imag), which RETURNS whether the point is inside the main cardioid or the period 2 bulb.
+    No point inside them ever escapes, so they need no iterations at all
+*/
+#define DEFINE_INTERIOR(name, type) \
+static int name(type real, type imag) \
+{ \
+    type imag2 = imag * imag; \
+    type shifted = real - (type) 0.25; \
+    type q = shifted * shifted + imag2; \
+    return q * (q + shifted) < (type) 0.25 * imag2 || (real + 1) * (real + 1) + imag2 < (type) 0.0625; \
+}
+
+DEFINE_INTERIOR(interior_float, float)
+DEFINE_INTERIOR(interior_double, double)
+DEFINE_INTERIOR(interior_long_double, long double)
+
+int escape(Coord query, int budget)
+{
+    long double real = query.real;
+    long double imag = query.imag;
+
+    if(interior_long_double(real, imag)) return 0;
+
+    //Brent's cycle check: the orbit is compared with the point saved at the last power of 2
+    long double saved_real = real, saved_imag = imag;
+    int save_at = 1;
+
+    for(int i = 1; i <= budget; i++)
+    {
+        long double real2 = real * real;
+        long double imag2 = imag * imag;
+
+        if(real2 + imag2 > 4)
+        {
+            return i;
+        }
+
+        imag = 2 * real * imag + query.imag;
+        real = real2 - imag2 + query.real;
+
+        //The orbit came back to a point exactly, so it repeats forever without escaping
+        if(real == saved_real && imag == saved_imag) return 0;
+
+        if(i == save_at)
+        {
+            saved_real = real;
+            saved_imag = imag;
+            save_at *= 2;
+        }
+    }
+
+    return 0;
+}
+
+//----------------------------------//
+
+//Kernels on a chunk of a row. Every kernel of a type does the same operations in the same order, so they agree bit for bit
+
+static int escape_float(float c_real, float c_imag, int budget)
+{
+    float real = c_real;
+    float imag = c_imag;
+
+    if(interior_float(real, imag)) return 0;
+
+    //Brent's cycle check: the orbit is compared with the point saved at the last power of 2
+    float saved_real = real, saved_imag = imag;
+    int save_at = 1;
+
+    for(int i = 1; i <= budget; i++)
+    {
+        float real2 = real * real;
+        float imag2 = imag * imag;
+
+        if(real2 + imag2 > 4)
+        {
+            return i;
+        }
+
+        imag = 2 * real * imag + c_imag;
+        real = real2 - imag2 + c_real;
+
+        //The orbit came back to a point exactly, so it repeats forever without escaping
+        if(real == saved_real && imag == saved_imag) return 0;
+
+        if(i == save_at)
+        {
+            saved_real = real;
+            saved_imag = imag;
+            save_at *= 2;
+        }
+    }
+
+    return 0;
+}
+
+static int escape_double(double c_real, double c_imag, int budget)
+{
+    double real = c_real;
+    double imag = c_imag;
+
+    if(interior_double(real, imag)) return 0;
+
+    //Brent's cycle check: the orbit is compared with the point saved at the last power of 2
+    double saved_real = real, saved_imag = imag;
+    int save_at = 1;
+
+    for(int i = 1; i <= budget; i++)
+    {
+        double real2 = real * real;
+        double imag2 = imag * imag;
+
+        if(real2 + imag2 > 4)
+        {
+            return i;
+        }
+
+        imag = 2 * real * imag + c_imag;
+        real = real2 - imag2 + c_real;
+
+        //The orbit came back to a point exactly, so it repeats forever without escaping
+        if(real == saved_real && imag == saved_imag) return 0;
+
+        if(i == save_at)
+        {
+            saved_real = real;
+            saved_imag = imag;
+            save_at *= 2;
+        }
+    }
+
+    return 0;
+}
+
+static void points_float_scalar(uint16_t* out, int count, const float* real, const float* imag, int budget)
+{
+    for(int k = 0; k < count; k++)
+    {
+        out[k] = escape_float(real[k], imag[k], budget);
+    }
+}
+
+static void points_double_scalar(uint16_t* out, int count, const double* real, const double* imag, int budget)
+{
+    for(int k = 0; k < count; k++)
+    {
+        out[k] = escape_double(real[k], imag[k], budget);
+    }
+}
+
+#ifdef ESCAPE_X86
+
+//Lanes which never escaped are reported as 0, the rest as the check they failed on
+#define STORE_LANES(out, n, live, width) \
+do { \
+    for(int lane = 0; lane < (width); lane++) \
+        (out)[lane] = ((live) >> lane) & 1 ? 0 : (uint16_t) (n)[lane] + 1; \
+} while (0)
+
+//RETURN a mask of the lanes inside the main cardioid or the period 2 bulb, the same test as the scalar one
+__attribute__((target("avx2")))
+static __m256 interior_float_avx2(__m256 x, __m256 y)
+{
+    __m256 y2 = _mm256_mul_ps(y, y);
+    __m256 shifted = _mm256_sub_ps(x, _mm256_set1_ps(0.25));
+    __m256 q = _mm256_add_ps(_mm256_mul_ps(shifted, shifted), y2);
+    __m256 cardioid = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, shifted)), _mm256_mul_ps(_mm256_set1_ps(0.25), y2), _CMP_LT_OQ);
+    __m256 shifted_bulb = _mm256_add_ps(x, _mm256_set1_ps(1.0));
+    __m256 bulb = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(shifted_bulb, shifted_bulb), y2), _mm256_set1_ps(0.0625), _CMP_LT_OQ);
+    return _mm256_or_ps(cardioid, bulb);
+}
+
+//16 points per call as two interleaved vectors of 8
+__attribute__((target("avx2")))
+static void points_float_avx2(uint16_t* out, int count, const float* real, const float* imag, int budget)
+{
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int k = 0;
+    for(; k + 16 <= count; k += 16)
+    {
+        __m256 c_real0 = _mm256_loadu_ps(real + k);
+        __m256 c_real1 = _mm256_loadu_ps(real + k + 8);
+        __m256 c_imag0 = _mm256_loadu_ps(imag + k);
+        __m256 c_imag1 = _mm256_loadu_ps(imag + k + 8);
+        __m256 x0 = c_real0, y0 = c_imag0, x1 = c_real1, y1 = c_imag1;
+        __m256 n0 = _mm256_setzero_ps(), n1 = _mm256_setzero_ps();
+        __m256 inside0 = interior_float_avx2(c_real0, c_imag0), inside1 = interior_float_avx2(c_real1, c_imag1);
+        __m256 live0 = _mm256_andnot_ps(inside0, _mm256_cmp_ps(n0, n0, _CMP_EQ_OQ));
+        __m256 live1 = _mm256_andnot_ps(inside1, _mm256_cmp_ps(n0, n0, _CMP_EQ_OQ));
+        __m256 saved_x0 = x0, saved_y0 = y0, saved_x1 = x1, saved_y1 = y1;
+        int save_at = 1;
+
+        for(int i = 0; i < budget; i++)
+        {
+            __m256 x2_0 = _mm256_mul_ps(x0, x0), y2_0 = _mm256_mul_ps(y0, y0);
+            __m256 x2_1 = _mm256_mul_ps(x1, x1), y2_1 = _mm256_mul_ps(y1, y1);
+
+            //Escaped lanes stay masked out even if their orbit overflows
+            live0 = _mm256_and_ps(live0, _mm256_cmp_ps(_mm256_add_ps(x2_0, y2_0), four, _CMP_LE_OQ));
+            live1 = _mm256_and_ps(live1, _mm256_cmp_ps(_mm256_add_ps(x2_1, y2_1), four, _CMP_LE_OQ));
+            if(_mm256_movemask_ps(_mm256_or_ps(live0, live1)) == 0) break;
+
+            n0 = _mm256_add_ps(n0, _mm256_and_ps(live0, one));
+            n1 = _mm256_add_ps(n1, _mm256_and_ps(live1, one));
+
+            __m256 xy0 = _mm256_mul_ps(x0, y0), xy1 = _mm256_mul_ps(x1, y1);
+            y0 = _mm256_add_ps(_mm256_add_ps(xy0, xy0), c_imag0);
+            y1 = _mm256_add_ps(_mm256_add_ps(xy1, xy1), c_imag1);
+            x0 = _mm256_add_ps(_mm256_sub_ps(x2_0, y2_0), c_real0);
+            x1 = _mm256_add_ps(_mm256_sub_ps(x2_1, y2_1), c_real1);
+
+            //Lanes whose orbit came back to the saved point exactly repeat forever without escaping
+            __m256 cycle0 = _mm256_and_ps(live0, _mm256_and_ps(_mm256_cmp_ps(x0, saved_x0, _CMP_EQ_OQ), _mm256_cmp_ps(y0, saved_y0, _CMP_EQ_OQ)));
+            __m256 cycle1 = _mm256_and_ps(live1, _mm256_and_ps(_mm256_cmp_ps(x1, saved_x1, _CMP_EQ_OQ), _mm256_cmp_ps(y1, saved_y1, _CMP_EQ_OQ)));
+            if(_mm256_movemask_ps(_mm256_or_ps(cycle0, cycle1)) != 0)
+            {
+                inside0 = _mm256_or_ps(inside0, cycle0);
+                inside1 = _mm256_or_ps(inside1, cycle1);
+                live0 = _mm256_andnot_ps(cycle0, live0);
+                live1 = _mm256_andnot_ps(cycle1, live1);
+            }
+
+            if(i + 1 == save_at)
+            {
+                saved_x0 = x0; saved_y0 = y0;
+                saved_x1 = x1; saved_y1 = y1;
+                save_at *= 2;
+            }
+        }
+
+        float n[16];
+        _mm256_storeu_ps(n, n0);
+        _mm256_storeu_ps(n + 8, n1);
+        int live = _mm256_movemask_ps(_mm256_or_ps(live0, inside0)) | (_mm256_movemask_ps(_mm256_or_ps(live1, inside1)) << 8);
+        STORE_LANES(out + k, n, live, 16);
+    }
+
+    points_float_scalar(out + k, count - k, real + k, imag + k, budget);
+}
+
+//RETURN a mask of the lanes inside the main cardioid or the period 2 bulb, the same test as the scalar one
+__attribute__((target("sse2")))
+static __m128 interior_float_sse2(__m128 x, __m128 y)
+{
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 shifted = _mm_sub_ps(x, _mm_set1_ps(0.25));
+    __m128 q = _mm_add_ps(_mm_mul_ps(shifted, shifted), y2);
+    __m128 cardioid = _mm_cmplt_ps(_mm_mul_ps(q, _mm_add_ps(q, shifted)), _mm_mul_ps(_mm_set1_ps(0.25), y2));
+    __m128 shifted_bulb = _mm_add_ps(x, _mm_set1_ps(1.0));
+    __m128 bulb = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(shifted_bulb, shifted_bulb), y2), _mm_set1_ps(0.0625));
+    return _mm_or_ps(cardioid, bulb);
+}
+
+//8 points per call as two interleaved vectors of 4
+__attribute__((target("sse2")))
+static void points_float_sse2(uint16_t* out, int count, const float* real, const float* imag, int budget)
+{
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    int k = 0;
+    for(; k + 8 <= count; k += 8)
+    {
+        __m128 c_real0 = _mm_loadu_ps(real + k);
+        __m128 c_real1 = _mm_loadu_ps(real + k + 4);
+        __m128 c_imag0 = _mm_loadu_ps(imag + k);
+        __m128 c_imag1 = _mm_loadu_ps(imag + k + 4);
+        __m128 x0 = c_real0, y0 = c_imag0, x1 = c_real1, y1 = c_imag1;
+        __m128 n0 = _mm_setzero_ps(), n1 = _mm_setzero_ps();
+        __m128 inside0 = interior_float_sse2(c_real0, c_imag0), inside1 = interior_float_sse2(c_real1, c_imag1);
+        __m128 live0 = _mm_andnot_ps(inside0, _mm_cmpeq_ps(n0, n0));
+        __m128 live1 = _mm_andnot_ps(inside1, _mm_cmpeq_ps(n0, n0));
+        __m128 saved_x0 = x0, saved_y0 = y0, saved_x1 = x1, saved_y1 = y1;
+        int save_at = 1;
+
+        for(int i = 0; i < budget; i++)
+        {
+            __m128 x2_0 = _mm_mul_ps(x0, x0), y2_0 = _mm_mul_ps(y0, y0);
+            __m128 x2_1 = _mm_mul_ps(x1, x1), y2_1 = _mm_mul_ps(y1, y1);
+
+            live0 = _mm_and_ps(live0, _mm_cmple_ps(_mm_add_ps(x2_0, y2_0), four));
+            live1 = _mm_and_ps(live1, _mm_cmple_ps(_mm_add_ps(x2_1, y2_1), four));
+            if(_mm_movemask_ps(_mm_or_ps(live0, live1)) == 0) break;
+
+            n0 = _mm_add_ps(n0, _mm_and_ps(live0, one));
+            n1 = _mm_add_ps(n1, _mm_and_ps(live1, one));
+
+            __m128 xy0 = _mm_mul_ps(x0, y0), xy1 = _mm_mul_ps(x1, y1);
+            y0 = _mm_add_ps(_mm_add_ps(xy0, xy0), c_imag0);
+            y1 = _mm_add_ps(_mm_add_ps(xy1, xy1), c_imag1);
+            x0 = _mm_add_ps(_mm_sub_ps(x2_0, y2_0), c_real0);
+            x1 = _mm_add_ps(_mm_sub_ps(x2_1, y2_1), c_real1);
+
+            //Lanes whose orbit came back to the saved point exactly repeat forever without escaping
+            __m128 cycle0 = _mm_and_ps(live0, _mm_and_ps(_mm_cmpeq_ps(x0, saved_x0), _mm_cmpeq_ps(y0, saved_y0)));
+            __m128 cycle1 = _mm_and_ps(live1, _mm_and_ps(_mm_cmpeq_ps(x1, saved_x1), _mm_cmpeq_ps(y1, saved_y1)));
+            if(_mm_movemask_ps(_mm_or_ps(cycle0, cycle1)) != 0)
+            {
+                inside0 = _mm_or_ps(inside0, cycle0);
+                inside1 = _mm_or_ps(inside1, cycle1);
+                live0 = _mm_andnot_ps(cycle0, live0);
+                live1 = _mm_andnot_ps(cycle1, live1);
+            }
+
+            if(i + 1 == save_at)
+            {
+                saved_x0 = x0; saved_y0 = y0;
+                saved_x1 = x1; saved_y1 = y1;
+                save_at *= 2;
+            }
+        }
+
+        float n[8];
+        _mm_storeu_ps(n, n0);
+        _mm_storeu_ps(n + 4, n1);
+        int live = _mm_movemask_ps(_mm_or_ps(live0, inside0)) | (_mm_movemask_ps(_mm_or_ps(live1, inside1)) << 4);
+        STORE_LANES(out + k, n, live, 8);
+    }
+
+    points_float_scalar(out + k, count - k, real + k, imag + k, budget);
+}
+
+//RETURN a mask of the lanes inside the main cardioid or the period 2 bulb, the same test as the scalar one
+__attribute__((target("avx2")))
+static __m256d interior_double_avx2(__m256d x, __m256d y)
+{
+    __m256d y2 = _mm256_mul_pd(y, y);
+    __m256d shifted = _mm256_sub_pd(x, _mm256_set1_pd(0.25));
+    __m256d q = _mm256_add_pd(_mm256_mul_pd(shifted, shifted), y2);
+    __m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, shifted)), _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LT_OQ);
+    __m256d shifted_bulb = _mm256_add_pd(x, _mm256_set1_pd(1.0));
+    __m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(shifted_bulb, shifted_bulb), y2), _mm256_set1_pd(0.0625), _CMP_LT_OQ);
+    return _mm256_or_pd(cardioid, bulb);
+}
+
+//8 points per call as two interleaved vectors of 4
+__attribute__((target("avx2")))
+static void points_double_avx2(uint16_t* out, int count, const double* real, const double* imag, int budget)
+{
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    int k = 0;
+    for(; k + 8 <= count; k += 8)
+    {
+        __m256d c_real0 = _mm256_loadu_pd(real + k);
+        __m256d c_real1 = _mm256_loadu_pd(real + k + 4);
+        __m256d c_imag0 = _mm256_loadu_pd(imag + k);
+        __m256d c_imag1 = _mm256_loadu_pd(imag + k + 4);
+        __m256d x0 = c_real0, y0 = c_imag0, x1 = c_real1, y1 = c_imag1;
+        __m256d n0 = _mm256_setzero_pd(), n1 = _mm256_setzero_pd();
+        __m256d inside0 = interior_double_avx2(c_real0, c_imag0), inside1 = interior_double_avx2(c_real1, c_imag1);
+        __m256d live0 = _mm256_andnot_pd(inside0, _mm256_cmp_pd(n0, n0, _CMP_EQ_OQ));
+        __m256d live1 = _mm256_andnot_pd(inside1, _mm256_cmp_pd(n0, n0, _CMP_EQ_OQ));
+        __m256d saved_x0 = x0, saved_y0 = y0, saved_x1 = x1, saved_y1 = y1;
+        int save_at = 1;
+
+        for(int i = 0; i < budget; i++)
+        {
+            __m256d x2_0 = _mm256_mul_pd(x0, x0), y2_0 = _mm256_mul_pd(y0, y0);
+            __m256d x2_1 = _mm256_mul_pd(x1, x1), y2_1 = _mm256_mul_pd(y1, y1);
+
+            //Escaped lanes stay masked out even if their orbit overflows
+            live0 = _mm256_and_pd(live0, _mm256_cmp_pd(_mm256_add_pd(x2_0, y2_0), four, _CMP_LE_OQ));
+            live1 = _mm256_and_pd(live1, _mm256_cmp_pd(_mm256_add_pd(x2_1, y2_1), four, _CMP_LE_OQ));
+            if(_mm256_movemask_pd(_mm256_or_pd(live0, live1)) == 0) break;
+
+            n0 = _mm256_add_pd(n0, _mm256_and_pd(live0, one));
+            n1 = _mm256_add_pd(n1, _mm256_and_pd(live1, one));
+
+            __m256d xy0 = _mm256_mul_pd(x0, y0), xy1 = _mm256_mul_pd(x1, y1);
+            y0 = _mm256_add_pd(_mm256_add_pd(xy0, xy0), c_imag0);
+            y1 = _mm256_add_pd(_mm256_add_pd(xy1, xy1), c_imag1);
+            x0 = _mm256_add_pd(_mm256_sub_pd(x2_0, y2_0), c_real0);
+            x1 = _mm256_add_pd(_mm256_sub_pd(x2_1, y2_1), c_real1);
+
+            //Lanes whose orbit came back to the saved point exactly repeat forever without escaping
+            __m256d cycle0 = _mm256_and_pd(live0, _mm256_and_pd(_mm256_cmp_pd(x0, saved_x0, _CMP_EQ_OQ), _mm256_cmp_pd(y0, saved_y0, _CMP_EQ_OQ)));
+            __m256d cycle1 = _mm256_and_pd(live1, _mm256_and_pd(_mm256_cmp_pd(x1, saved_x1, _CMP_EQ_OQ), _mm256_cmp_pd(y1, saved_y1, _CMP_EQ_OQ)));
+            if(_mm256_movemask_pd(_mm256_or_pd(cycle0, cycle1)) != 0)
+            {
+                inside0 = _mm256_or_pd(inside0, cycle0);
+                inside1 = _mm256_or_pd(inside1, cycle1);
+                live0 = _mm256_andnot_pd(cycle0, live0);
+                live1 = _mm256_andnot_pd(cycle1, live1);
+            }
+
+            if(i + 1 == save_at)
+            {
+                saved_x0 = x0; saved_y0 = y0;
+                saved_x1 = x1; saved_y1 = y1;
+                save_at *= 2;
+            }
+        }
+
+        double n[8];
+        _mm256_storeu_pd(n, n0);
+        _mm256_storeu_pd(n + 4, n1);
+        int live = _mm256_movemask_pd(_mm256_or_pd(live0, inside0)) | (_mm256_movemask_pd(_mm256_or_pd(live1, inside1)) << 4);
+        STORE_LANES(out + k, n, live, 8);
+    }
+
+    points_double_scalar(out + k, count - k, real + k, imag + k, budget);
+}
+
+//RETURN a mask of the lanes inside the main cardioid or the period 2 bulb, the same test as the scalar one
+__attribute__((target("sse2")))
+static __m128d interior_double_sse2(__m128d x, __m128d y)
+{
+    __m128d y2 = _mm_mul_pd(y, y);
+    __m128d shifted = _mm_sub_pd(x, _mm_set1_pd(0.25));
+    __m128d q = _mm_add_pd(_mm_mul_pd(shifted, shifted), y2);
+    __m128d cardioid = _mm_cmplt_pd(_mm_mul_pd(q, _mm_add_pd(q, shifted)), _mm_mul_pd(_mm_set1_pd(0.25), y2));
+    __m128d shifted_bulb = _mm_add_pd(x, _mm_set1_pd(1.0));
+    __m128d bulb = _mm_cmplt_pd(_mm_add_pd(_mm_mul_pd(shifted_bulb, shifted_bulb), y2), _mm_set1_pd(0.0625));
+    return _mm_or_pd(cardioid, bulb);
+}
+
+//4 points per call as two interleaved vectors of 2
+__attribute__((target("sse2")))
+static void points_double_sse2(uint16_t* out, int count, const double* real, const double* imag, int budget)
+{
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+
+    int k = 0;
+    for(; k + 4 <= count; k += 4)
+    {
+        __m128d c_real0 = _mm_loadu_pd(real + k);
+        __m128d c_real1 = _mm_loadu_pd(real + k + 2);
+        __m128d c_imag0 = _mm_loadu_pd(imag + k);
+        __m128d c_imag1 = _mm_loadu_pd(imag + k + 2);
+        __m128d x0 = c_real0, y0 = c_imag0, x1 = c_real1, y1 = c_imag1;
+        __m128d n0 = _mm_setzero_pd(), n1 = _mm_setzero_pd();
+        __m128d inside0 = interior_double_sse2(c_real0, c_imag0), inside1 = interior_double_sse2(c_real1, c_imag1);
+        __m128d live0 = _mm_andnot_pd(inside0, _mm_cmpeq_pd(n0, n0));
+        __m128d live1 = _mm_andnot_pd(inside1, _mm_cmpeq_pd(n0, n0));
+        __m128d saved_x0 = x0, saved_y0 = y0, saved_x1 = x1, saved_y1 = y1;
+        int save_at = 1;
+
+        for(int i = 0; i < budget; i++)
+        {
+            __m128d x2_0 = _mm_mul_pd(x0, x0), y2_0 = _mm_mul_pd(y0, y0);
+            __m128d x2_1 = _mm_mul_pd(x1, x1), y2_1 = _mm_mul_pd(y1, y1);
+
+            live0 = _mm_and_pd(live0, _mm_cmple_pd(_mm_add_pd(x2_0, y2_0), four));
+            live1 = _mm_and_pd(live1, _mm_cmple_pd(_mm_add_pd(x2_1, y2_1), four));
+            if(_mm_movemask_pd(_mm_or_pd(live0, live1)) == 0) break;
+
+            n0 = _mm_add_pd(n0, _mm_and_pd(live0, one));
+            n1 = _mm_add_pd(n1, _mm_and_pd(live1, one));
+
+            __m128d xy0 = _mm_mul_pd(x0, y0), xy1 = _mm_mul_pd(x1, y1);
+            y0 = _mm_add_pd(_mm_add_pd(xy0, xy0), c_imag0);
+            y1 = _mm_add_pd(_mm_add_pd(xy1, xy1), c_imag1);
+            x0 = _mm_add_pd(_mm_sub_pd(x2_0, y2_0), c_real0);
+            x1 = _mm_add_pd(_mm_sub_pd(x2_1, y2_1), c_real1);
+
+            //Lanes whose orbit came back to the saved point exactly repeat forever without escaping
+            __m128d cycle0 = _mm_and_pd(live0, _mm_and_pd(_mm_cmpeq_pd(x0, saved_x0), _mm_cmpeq_pd(y0, saved_y0)));
+            __m128d cycle1 = _mm_and_pd(live1, _mm_and_pd(_mm_cmpeq_pd(x1, saved_x1), _mm_cmpeq_pd(y1, saved_y1)));
+            if(_mm_movemask_pd(_mm_or_pd(cycle0, cycle1)) != 0)
+            {
+                inside0 = _mm_or_pd(inside0, cycle0);
+                inside1 = _mm_or_pd(inside1, cycle1);
+                live0 = _mm_andnot_pd(cycle0, live0);
+                live1 = _mm_andnot_pd(cycle1, live1);
+            }
+
+            if(i + 1 == save_at)
+            {
+                saved_x0 = x0; saved_y0 = y0;
+                saved_x1 = x1; saved_y1 = y1;
+                save_at *= 2;
+            }
+        }
+
+        double n[4];
+        _mm_storeu_pd(n, n0);
+        _mm_storeu_pd(n + 2, n1);
+        int live = _mm_movemask_pd(_mm_or_pd(live0, inside0)) | (_mm_movemask_pd(_mm_or_pd(live1, inside1)) << 2);
+        STORE_LANES(out + k, n, live, 4);
+    }
+
+    points_double_scalar(out + k, count - k, real + k, imag + k, budget);
+}
+
+#endif // #ifdef ESCAPE_X86
+
+//RETURN the float kernel for the best instruction set the cpu supports
+static void (*pick_float_kernel())(uint16_t*, int, const float*, const float*, int)
+{
+#ifdef ESCAPE_X86
+    if(__builtin_cpu_supports("avx2")) return points_float_avx2;
+    if(__builtin_cpu_supports("sse2")) return points_float_sse2;
+#endif
+    return points_float_scalar;
+}
+
+//RETURN the double kernel for the best instruction set the cpu supports
+static void (*pick_double_kernel())(uint16_t*, int, const double*, const double*, int)
+{
+#ifdef ESCAPE_X86
+    if(__builtin_cpu_supports("avx2")) return points_double_avx2;
+    if(__builtin_cpu_supports("sse2")) return points_double_sse2;
+#endif
+    return points_double_scalar;
+}
+
+const char* escape_isa()
+{
+    void (*kernel)(uint16_t*, int, const double*, const double*, int) = pick_double_kernel();
+
+#ifdef ESCAPE_X86
+    if(kernel == points_double_avx2) return "AVX2";
+    if(kernel == points_double_sse2) return "SSE2";
+#endif
+    return "scalar";
+}
+
+//----------------------------------//
+
+//Double-double numbers: the unevaluated sum hi + lo, with about 106 bits of mantissa between them
+
+typedef struct Double2
+{
+    double hi;
+    double lo;
+} Double2;
+
+//RETURN long double x as a double-double, exactly
+static Double2 dd_from(long double x)
+{
+    Double2 r;
+    r.hi = (double) x;
+    r.lo = (double) (x - r.hi);
+    return r;
+}
+
+//RETURN a + b, with the rounding error of the sum carried in lo
+static Double2 dd_add(Double2 a, Double2 b)
+{
+    double sum = a.hi + b.hi;
+    double bb = sum - a.hi;
+    double err = (a.hi - (sum - bb)) + (b.hi - bb);
+
+    err += a.lo + b.lo;
+
+    Double2 r;
+    r.hi = sum + err;
+    r.lo = err - (r.hi - sum);
+    return r;
+}
+
+//SPLITS a into two halves of 26 bits, so their products are exact (Dekker)
+static void dd_split(double a, double* p_hi, double* p_lo)
+{
+    double t = 134217729.0 * a; //2^27 + 1
+    *p_hi = t - (t - a);
+    *p_lo = a - *p_hi;
+}
+
+//RETURN a * b, with the rounding error of the product carried in lo
+static Double2 dd_mul(Double2 a, Double2 b)
+{
+    double a_hi, a_lo, b_hi, b_lo;
+    dd_split(a.hi, &a_hi, &a_lo);
+    dd_split(b.hi, &b_hi, &b_lo);
+
+    double product = a.hi * b.hi;
+    double err = ((a_hi * b_hi - product) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+
+    err += a.hi * b.lo + a.lo * b.hi;
+
+    Double2 r;
+    r.hi = product + err;
+    r.lo = err - (r.hi - product);
+    return r;
+}
+
+//RETURN -a
+static Double2 dd_neg(Double2 a)
+{
+    a.hi = -a.hi;
+    a.lo = -a.lo;
+    return a;
+}
+
+static int escape_double_double(Double2 c_real, Double2 c_imag, int budget)
+{
+    Double2 real = c_real;
+    Double2 imag = c_imag;
+
+    if(interior_double(real.hi, imag.hi)) return 0;
+
+    //Brent's cycle check: the orbit is compared with the point saved at the last power of 2
+    Double2 saved_real = real, saved_imag = imag;
+    int save_at = 1;
+
+    for(int i = 1; i <= budget; i++)
+    {
+        Double2 real2 = dd_mul(real, real);
+        Double2 imag2 = dd_mul(imag, imag);
+
+        if(real2.hi + imag2.hi > 4)
+        {
+            return i;
+        }
+
+        Double2 product = dd_mul(real, imag);
+        imag = dd_add(dd_add(product, product), c_imag);
+        real = dd_add(dd_add(real2, dd_neg(imag2)), c_real);
+
+        //The orbit came back to a point exactly, so it repeats forever without escaping
+        if(real.hi == saved_real.hi && real.lo == saved_real.lo && imag.hi == saved_imag.hi && imag.lo == saved_imag.lo) return 0;
+
+        if(i == save_at)
+        {
+            saved_real = real;
+            saved_imag = imag;
+            save_at *= 2;
+        }
+    }
+
+    return 0;
+}
+
+//----------------------------------//
+
+Precision escape_precision(long double magnitude, long double step)
+{
+    if(step >= magnitude * FLOAT_LIMIT) return PRECISION_FLOAT;
+    if(step >= magnitude * DOUBLE_LIMIT) return PRECISION_DOUBLE;
+    if(step >= magnitude * LONG_DOUBLE_LIMIT) return PRECISION_LONG_DOUBLE;
+    if(step >= magnitude * DOUBLE_DOUBLE_LIMIT) return PRECISION_DOUBLE_DOUBLE;
+    return PRECISION_PERTURBATION;
+}
+
+const char* precision_name(Precision precision)
+{
+    switch(precision)
+    {
+        case PRECISION_FLOAT: return "float";
+        case PRECISION_DOUBLE: return "double";
+        case PRECISION_LONG_DOUBLE: return "long double";
+        case PRECISION_DOUBLE_DOUBLE: return "double-double";
+        case PRECISION_PERTURBATION: return "perturbation";
+    }
+    return "unknown";
+}
+
+//A row of points, or a list of pixels of a view. See escape_row and escape_pixels
+typedef struct Points
+{
+    Coord mid;
+    Coord offset;
+    Coord step;
+    int first; //For a row, the index of its first point. For a list, the row of the view pixel 0 is on
+    int width; //For a list, pixels are numbered y * width + x
+    const int* pixels; //The list, NULL for a row
+    int budget; //The most iterations a point is given
+} Points;
+
+//RETURN where the count of point k goes
+static long point_index(const Points* points, int k)
+{
+    return points->pixels != NULL ? points->pixels[k] : k;
+}
+
+//RETURN the offset from mid along the real axis of point k, leaving out offset.real
+static long double point_real(const Points* points, int k)
+{
+    int x = points->pixels != NULL ? points->pixels[k] % points->width : points->first + k;
+    return x * points->step.real;
+}
+
+//RETURN the offset from mid along the imaginary axis of point k
+static long double point_imag(const Points* points, int k)
+{
+    if(points->pixels == NULL) return points->offset.imag;
+    return points->offset.imag + (points->first + points->pixels[k] / points->width) * points->step.imag;
+}
+
+//FILLS out with the escape counts of the count points, each at point_index
+static void escape_points(uint16_t* out, int count, const Points* points, Precision precision)
+{
+    //The real part of every point is measured from here, as a row always has been
+    long double start_real = points->mid.real + points->offset.real;
+
+    if(precision == PRECISION_LONG_DOUBLE)
+    {
+        Coord point;
+        for(int k = 0; k < count; k++)
+        {
+            point.real = start_real + point_real(points, k);
+            point.imag = points->mid.imag + point_imag(points, k);
+            out[point_index(points, k)] = escape(point, points->budget);
+        }
+        return;
+    }
+
+    //mid and the offsets are kept apart, so the points are not rounded to long double
+    if(precision == PRECISION_DOUBLE_DOUBLE)
+    {
+        Double2 mid_real = dd_from(points->mid.real);
+        Double2 mid_imag = dd_from(points->mid.imag);
+
+        for(int k = 0; k < count; k++)
+        {
+            Double2 c_real = dd_add(mid_real, dd_from(points->offset.real + point_real(points, k)));
+            Double2 c_imag = dd_add(mid_imag, dd_from(point_imag(points, k)));
+            out[point_index(points, k)] = escape_double_double(c_real, c_imag, points->budget);
+        }
+        return;
+    }
+
+    uint16_t counts[ESCAPE_CHUNK];
+
+    if(precision == PRECISION_FLOAT)
+    {
+        void (*kernel)(uint16_t*, int, const float*, const float*, int) = pick_float_kernel();
+        float real[ESCAPE_CHUNK], imag[ESCAPE_CHUNK];
+
+        for(int chunk = 0; chunk < count; chunk += ESCAPE_CHUNK)
+        {
+            int length = count - chunk < ESCAPE_CHUNK ? count - chunk : ESCAPE_CHUNK;
+            int padded = (length + ESCAPE_PAD - 1) / ESCAPE_PAD * ESCAPE_PAD;
+
+            for(int k = 0; k < padded; k++)
+            {
+                int point = chunk + (k < length ? k : length - 1);
+                real[k] = (float) (start_real + point_real(points, point));
+                imag[k] = (float) (points->mid.imag + point_imag(points, point));
+            }
+
+            kernel(counts, padded, real, imag, points->budget);
+            for(int k = 0; k < length; k++) out[point_index(points, chunk + k)] = counts[k];
+        }
+        return;
+    }
+
+    void (*kernel)(uint16_t*, int, const double*, const double*, int) = pick_double_kernel();
+    double real[ESCAPE_CHUNK], imag[ESCAPE_CHUNK];
+
+    for(int chunk = 0; chunk < count; chunk += ESCAPE_CHUNK)
+    {
+        int length = count - chunk < ESCAPE_CHUNK ? count - chunk : ESCAPE_CHUNK;
+        int padded = (length + ESCAPE_PAD - 1) / ESCAPE_PAD * ESCAPE_PAD;
+
+        for(int k = 0; k < padded; k++)
+        {
+            int point = chunk + (k < length ? k : length - 1);
+            real[k] = (double) (start_real + point_real(points, point));
+            imag[k] = (double) (points->mid.imag + point_imag(points, point));
+        }
+
+        kernel(counts, padded, real, imag, points->budget);
+        for(int k = 0; k < length; k++) out[point_index(points, chunk + k)] = counts[k];
+    }
+}
+
+void escape_row(uint16_t* out, int count, Coord mid, Coord offset, long double step, int first, Precision precision, int budget)
+{
+    Points points;
+    points.mid = mid;
+    points.offset = offset;
+    points.step.real = step;
+    points.step.imag = 0;
+    points.first = first;
+    points.width = 0;
+    points.pixels = NULL;
+    points.budget = budget;
+
+    escape_points(out, count, &points, precision);
+}
+
+void escape_pixels(uint16_t* iters, int width, int first_row, const int* pixels, int count, Coord mid, Coord offset, Coord step, Precision precision, int budget)
+{
+    Points points;
+    points.mid = mid;
+    points.offset = offset;
+    points.step = step;
+    points.first = first_row;
+    points.width = width;
+    points.pixels = pixels;
+    points.budget = budget;
+
+    escape_points(iters, count, &points, precision);
+}
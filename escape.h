@@ -0,0 +1,87 @@
+#ifndef _ESCAPE
+#define _ESCAPE
+
+//Escape-time kernels for the mandelbrot set
+
+#include "helper.h"
+
+/*
+    Below each of these pixel spacings (relative to the size of the coordinates) a type runs out of bits for the pixels.
+    Each leaves about a dozen bits of headroom below the pixel for the error the iterations build up.
+    Float has too few bits for that anywhere near the boundary, so its counts there are only approximate: it is
+    kept for views too coarse to show it, a few dozen pixels across, and a screen sized view starts at double.
+*/
+#define FLOAT_LIMIT 0x1p-5L
+#define DOUBLE_LIMIT 0x1p-40L
+#define LONG_DOUBLE_LIMIT 0x1p-52L
+#define DOUBLE_DOUBLE_LIMIT 0x1p-92L
+
+//The arithmetic a view is iterated in, from cheapest to most precise
+typedef enum Precision
+{
+    PRECISION_FLOAT, //SIMD float lanes
+    PRECISION_DOUBLE, //SIMD double lanes
+    PRECISION_LONG_DOUBLE, //x87 long double, one point at a time
+    PRECISION_DOUBLE_DOUBLE, //Pairs of doubles, one point at a time
+    PRECISION_PERTURBATION //Doubles as offsets from a reference orbit, see deep.h
+} Precision;
+
+/*
+    RETURNS the number of iterations it takes for query to escape. Return 0 if query does not escape within budget (arbitrary decision to make colouring easier)
+    This is the reference kernel, done one point at a time in long double. Points in the main cardioid or the
+    period 2 bulb return 0 without iterating, and so do orbits caught repeating a point exactly (Brent's method)
+
+    \param query - the coordinate in question
+    \param budget - the number of iterations after which query is considered to be in the set, at most MAX_ITERATIONS
+*/
+int escape(Coord query, int budget);
+
+/*
+    RETURN the cheapest precision that can still tell neighbouring pixels apart
+
+    \param magnitude The largest coordinate of the view along either axis
+    \param step The distance between neighbouring pixels (cartesian units/pixel)
+*/
+Precision escape_precision(long double magnitude, long double step);
+
+//RETURN a name for precision to show in the log
+const char* precision_name(Precision precision);
+
+/*
+    FILLS out with the escape counts of count points along a row, the same values escape() would return
+    had it been done in precision. Float and double rows are iterated several points at a time in SIMD
+    lanes, using AVX2 or SSE2 depending on what the cpu supports.
+    Point k is mid + offset.real + (first + k) * step, so a row split into pieces gives the same counts as a whole one.
+
+    \param out Where the escape counts are written, count entries long
+    \param count The number of points
+    \param mid The centre of the view the row is in
+    \param offset The offset from mid of the leftmost point of the whole row
+    \param step The distance between neighbouring points (cartesian units/pixel)
+    \param first The index in the row of the first point
+    \param precision The arithmetic to iterate in, anything but PRECISION_PERTURBATION
+    \param budget The number of iterations after which a point is considered to be in the set, at most MAX_ITERATIONS
+*/
+void escape_row(uint16_t* out, int count, Coord mid, Coord offset, long double step, int first, Precision precision, int budget);
+
+/*
+    FILLS the listed pixels of iters with their escape counts, the same values escape_row gives them.
+    Pixel y * width + x is point x of the row whose offset.imag is offset.imag + (first_row + y) * step.imag
+
+    \param iters The escape counts of the whole view, or of a band of its rows, in row major order
+    \param width The width of the view in pixels
+    \param first_row The row of the view held in the first row of iters, 0 for a whole view
+    \param pixels The indices in iters of the pixels to fill
+    \param count The number of pixels
+    \param mid The centre of the view
+    \param offset The offset from mid of the top left pixel of the view
+    \param step The distance between neighbouring pixels along each axis (cartesian units/pixel)
+    \param precision The arithmetic to iterate in, anything but PRECISION_PERTURBATION
+    \param budget The number of iterations after which a point is considered to be in the set, at most MAX_ITERATIONS
+*/
+void escape_pixels(uint16_t* iters, int width, int first_row, const int* pixels, int count, Coord mid, Coord offset, Coord step, Precision precision, int budget);
+
+//RETURN the name of the instruction set escape_row uses on this machine
+const char* escape_isa();
+
+#endif // #ifndef _ESCAPE
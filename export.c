@@ -0,0 +1,1060 @@
+#include "export.h"
+#include "gifenc.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+//The environment of this process, handed on to the processes of the shards
+extern char** environ;
+
+//The reorder buffer holds this many frames per thread
+#define SLOTS_PER_THREAD 2
+
+//The progress line is redrawn at most this often, in seconds
+#define PROGRESS_INTERVAL 0.25
+
+//The longest path of a fragment, and of the comment identifying it
+#define SHARD_PATH 1024
+#define SHARD_COMMENT 256
+
+//Fragments are copied into the merged gif this many bytes at a time
+#define SHARD_CHUNK 0x10000
+
+//Where the time of one frame went, in seconds since the export started
+typedef struct Frame_Trace
+{
+    int thread; //The render thread that iterated it
+    Precision precision;
+
+    double viewport_start; //gif_viewport
+    double iterate_start; //gif_render
+    double iterate_end;
+    double encode_start; //Mapping to the palette, then ge_add_frame
+
+    //Seconds spent in each stage of the encoder
+    double palette;
+    double rects;
+    double lzw;
+    double write;
+
+    long iterations; //Escape counts summed, points in the set counted as BASE_ITERATIONS
+} Frame_Trace;
+
+//State shared by the threads rendering a gif
+typedef struct Gif_Job
+{
+    ge_GIF* gif;
+    const Timeline* timeline;
+    int sidelength;
+    int first; //The index in the whole gif of the first frame encoded
+    int nframes; //The number of frames encoded
+    int mili_duration;
+    Render_Mode mode;
+    Cache* cache;
+    uint8_t lut[MAX_ITERATIONS + 1]; //The palette colour of every escape count
+
+    //Ring of rendered frames waiting for the encoder. Frame i goes in slot i % nslots
+    int nslots;
+    Iter_Buffer** slots;
+    int* ready; //The frame held by each slot once it is rendered, -1 otherwise
+
+    //Guards everything below
+    pthread_mutex_t lock;
+    pthread_cond_t freed; //Signalled when the encoder empties a slot
+    pthread_cond_t filled; //Signalled when the frame the encoder waits for is ready
+
+    int next_frame; //The next frame to be claimed by a render thread
+    int next_encode; //The next frame to be encoded
+
+    //Seconds each stage spent stalled on the other, and the encoder's busy time
+    double render_stall; //Summed over the render threads
+    double encode_stall;
+    double encode_busy;
+
+    int precisions[PRECISION_PERTURBATION + 1]; //The number of frames iterated in each precision
+    int reused; //The number of frames copied from the counts of their snapshot
+
+    //Where the encoder writes checkpoints, NULL for none, and how many seconds apart (see Gif_Options)
+    const char* checkpoint;
+    double checkpoint_interval;
+    double last_checkpoint;
+    uint64_t export;
+
+    //Only touched by the thread handling the frame, never under the lock
+    Frame_Trace* traces;
+    int nthreads;
+    double start; //When the export started
+    int progress;
+    double last_progress; //When the encoder last redrew the progress line
+} Gif_Job;
+
+//RETURN a monotonic time in seconds
+static double seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+Gif_Options gif_default_options()
+{
+    Gif_Options options;
+    options.delta = 1;
+    options.rects = 1;
+    options.mode = RENDER_BRUTE_FORCE;
+    options.cache = NULL;
+    options.progress = 1;
+    options.trace = getenv(TRACE_ENV);
+    options.shards = 1;
+    options.program = NULL;
+
+    const char* checkpoint = getenv(CHECKPOINT_ENV);
+    options.checkpoint = checkpoint != NULL ? atof(checkpoint) : 0;
+    return options;
+}
+
+void gif_viewport(const Timeline* timeline, int index, Coord* p_max, Coord* p_mid)
+{
+    //Find the snapshot the frame leaves from
+    int panel = timeline_find(timeline, index, &index);
+    const Panel* root = &timeline->panels[panel];
+
+    if(panel == timeline->npanels - 1 || index == 0)
+    {
+        *p_max = root->max;
+        *p_mid = root->mid;
+        return;
+    }
+
+    const Panel* next_panel = root + 1;
+    int numframes = FRAMERATE * root->duration;
+
+    p_mid->real = root->mid.real + (next_panel->mid.real - root->mid.real) * index / numframes;
+    p_mid->imag = root->mid.imag + (next_panel->mid.imag - root->mid.imag) * index / numframes;
+
+    //max is half the size of the screen, interpolated on its own so deep views keep their precision
+    p_max->real = root->max.real + (next_panel->max.real - root->max.real) * index / numframes;
+    p_max->imag = root->max.imag + (next_panel->max.imag - root->max.imag) * index / numframes;
+}
+
+Precision gif_render(Iter_Buffer* buffer, Pool* p_pool, Cache* p_cache, Coord max, Coord mid, Render_Mode mode)
+{
+    //Less than a pixel off, so frames revisiting a view share its tiles
+    if(p_cache != NULL) mid = snap_mid(buffer->width, buffer->height, max, mid);
+
+    return render_buffer(p_pool, p_cache, buffer, max, mid, mode);
+}
+
+//RETURN the counts kept with the snapshot frame index of the gif shows, NULL if it is between snapshots or they have none
+static const Iter_Buffer* snapshot_counts(const Timeline* timeline, int index)
+{
+    int panel = timeline_find(timeline, index, &index);
+    return index == 0 ? timeline->counts[panel] : NULL;
+}
+
+/*
+    RENDERS frame index of the gif of timeline, whose viewport is max and mid (see gif_viewport), into buffer as
+    gif_render does. A frame showing the very view of a snapshot copies the counts kept with it instead. RETURNS
+    whether they were copied
+*/
+static int gif_frame(Iter_Buffer* buffer, Pool* p_pool, Cache* p_cache, const Timeline* timeline, int index, Coord max, Coord mid, Render_Mode mode)
+{
+    const Iter_Buffer* counts = snapshot_counts(timeline, index);
+    Coord view_mid = p_cache != NULL ? snap_mid(buffer->width, buffer->height, max, mid) : mid;
+
+    if(buffer_holds(counts, buffer->width, buffer->height, max, view_mid, mode))
+    {
+        fill_buffer(buffer, counts);
+        return 1;
+    }
+
+    gif_render(buffer, p_pool, p_cache, max, mid, mode);
+    return 0;
+}
+
+/*
+    ADD the escape counts in buffer to the gif as its next frame
+
+    \param lut The palette colour of every escape count, see palette_lut
+    \param trace Where the time spent in each stage and the iterations of the frame are stored
+*/
+static void gif_encode(ge_GIF* gif, const uint8_t* lut, const Iter_Buffer* buffer, int mili_duration, Frame_Trace* trace)
+{
+    double start = seconds();
+    long iterations = 0;
+    const uint16_t* iters = buffer->iters;
+
+    //Counts wrap around the palette, leaving the index above it free to be transparent
+    for(long pixel = 0; pixel < (long) gif->w * gif->h; pixel++)
+    {
+        gif->frame[pixel] = lut[iters[pixel]];
+        iterations += iters[pixel] == 0 ? BASE_ITERATIONS : iters[pixel];
+    }
+
+    trace->palette = seconds() - start;
+    trace->iterations = iterations;
+
+    double rects = gif->rects_time, lzw = gif->lzw_time, write = gif->sink->emit_time;
+    ge_add_frame(gif, mili_duration);
+
+    trace->rects = gif->rects_time - rects;
+    trace->lzw = gif->lzw_time - lzw;
+    trace->write = gif->sink->emit_time - write;
+}
+
+//WRITES seconds as h:mm:ss into text, which holds at least 32 characters
+static void format_duration(char* text, double seconds)
+{
+    long whole = seconds > 0 ? (long) seconds : 0;
+    snprintf(text, 32, "%ld:%02ld:%02ld", whole / 3600, whole / 60 % 60, whole % 60);
+}
+
+//PRINTS the progress line over the last one, once done frames of the gif are encoded
+static void print_progress(Gif_Job* job, int done)
+{
+    double now = seconds();
+    if(done < job->nframes && now - job->last_progress < PROGRESS_INTERVAL) return;
+    job->last_progress = now;
+
+    double rate = done / (now - job->start);
+    char left[32];
+    format_duration(left, (job->nframes - done) / rate);
+
+    printf("\rFrame %d/%d, %.1f frames/s, %s left ", done, job->nframes, rate, left);
+    if(done == job->nframes) printf("\n");
+    fflush(stdout);
+}
+
+/*
+    WRITES the stages of every frame to path, as Chrome trace JSON (chrome://tracing, Perfetto) if path ends
+    in .json and as one CSV line per frame otherwise. RETURNS 0 on success, -1 if path could not be written
+*/
+static int write_trace(Gif_Job* job, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if(file == NULL) return -1;
+
+    int length = strlen(path);
+    int json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+    long pixels = (long) job->sidelength * job->sidelength;
+
+    if(json) fprintf(file, "{\"traceEvents\": [\n");
+    else fprintf(file, "frame,thread,precision,start_s,viewport_s,iterate_s,palette_s,rects_s,lzw_s,write_s,end_s,iterations,pixels\n");
+
+    for(int frame = 0; frame < job->nframes; frame++)
+    {
+        Frame_Trace* trace = &job->traces[frame];
+        double end = trace->encode_start + trace->palette + trace->rects + trace->lzw + trace->write;
+
+        if(!json)
+        {
+            fprintf(file, "%d,%d,%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%ld,%ld\n",
+                    job->first + frame, trace->thread, precision_name(trace->precision), trace->viewport_start,
+                    trace->iterate_start - trace->viewport_start, trace->iterate_end - trace->iterate_start,
+                    trace->palette, trace->rects, trace->lzw, trace->write, end, trace->iterations, pixels);
+            continue;
+        }
+
+        //Render threads are tids 0 up, the encoder comes after them. The encoder's stages are laid end to end
+        const char* names[6] = {"viewport", "iterate", "palette", "rects", "lzw", "write"};
+        double starts[6] = {trace->viewport_start, trace->iterate_start, trace->encode_start, 0, 0, 0};
+        double lengths[6] = {trace->iterate_start - trace->viewport_start, trace->iterate_end - trace->iterate_start,
+                             trace->palette, trace->rects, trace->lzw, trace->write};
+
+        for(int stage = 3; stage < 6; stage++) starts[stage] = starts[stage - 1] + lengths[stage - 1];
+
+        for(int stage = 0; stage < 6; stage++)
+        {
+            fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                    "\"args\": {\"frame\": %d, \"precision\": \"%s\", \"iterations\": %ld}}",
+                    frame == 0 && stage == 0 ? "" : ",\n", names[stage], stage < 2 ? trace->thread : job->nthreads,
+                    starts[stage] * 1e6, lengths[stage] * 1e6, job->first + frame, precision_name(trace->precision), trace->iterations);
+        }
+    }
+
+    if(json) fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+//----------------------------------//
+
+//MIXES text into an FNV-1a hash
+static uint64_t hash_text(uint64_t hash, const char* text)
+{
+    for(; *text != '\0'; text++)
+    {
+        hash ^= (uint8_t) *text;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//RETURN a hash of everything the frames of the gif depend on, so the fragments and checkpoints of another export are never taken for this one's
+static uint64_t export_hash(int sidelength, const Timeline* timeline, Gif_Options options)
+{
+    //With a cache the views are snapped onto its grid (see gif_render), which moves them
+    char part[128];
+    snprintf(part, sizeof(part), "%d %d %d %d %d", sidelength, options.delta, options.rects, options.mode, options.cache != NULL);
+    uint64_t hash = hash_text(14695981039346656037ULL, part);
+
+    //Hexadecimal keeps every bit of the coordinates
+    for(int i = 0; i < timeline->npanels; i++)
+    {
+        const Panel* node = &timeline->panels[i];
+        snprintf(part, sizeof(part), ";%La %La %La %La %d", node->mid.real, node->mid.imag, node->max.real, node->max.imag, node->duration);
+        hash = hash_text(hash, part);
+    }
+
+    return hash;
+}
+
+//A checkpoint file starts with this, then holds the last frame written as palette colours, sidelength by sidelength
+typedef struct Checkpoint
+{
+    char magic[8];
+    uint64_t export; //See export_hash
+    int32_t sidelength;
+    int32_t next; //The first frame not written yet
+    int64_t offset; //Where the frames before it end in the gif
+} Checkpoint;
+
+static const char checkpoint_magic[8] = {'F', 'R', 'A', 'C', 'C', 'K', 'P', 'T'};
+
+//WRITES the path of the checkpoint of the gif filename into path, which holds length characters
+static void checkpoint_path(char* path, int length, const char* filename)
+{
+    snprintf(path, length, "%s.checkpoint", filename);
+}
+
+/*
+    WRITES a checkpoint of the gif to path once the frames before next are on disk: where they end, and the
+    last of them, which the deltas of the next frame are taken against. RETURNS 0 on success, -1 otherwise
+*/
+static int write_checkpoint(const char* path, ge_GIF* gif, uint64_t export, int next)
+{
+    //The frames have to be on disk before a checkpoint points past them
+    if(ge_sink_flush(gif->sink) != 0 || fsync(gif->sink->fd) != 0) return -1;
+
+    Checkpoint checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    memcpy(checkpoint.magic, checkpoint_magic, sizeof(checkpoint.magic));
+    checkpoint.export = export;
+    checkpoint.sidelength = gif->w;
+    checkpoint.next = next;
+    checkpoint.offset = gif->sink->offset;
+
+    //Written beside the last one and renamed over it, so a checkpoint is never half written
+    char temp[SHARD_PATH];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE* file = fopen(temp, "wb");
+    if(file == NULL) return -1;
+
+    size_t pixels = (size_t) gif->w * gif->h;
+    int error = fwrite(&checkpoint, sizeof(checkpoint), 1, file) != 1 || fwrite(gif->back, 1, pixels, file) != pixels;
+    if(fclose(file) != 0) error = 1;
+
+    if(error || rename(temp, path) != 0)
+    {
+        remove(temp);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+    READS the checkpoint at path into p_checkpoint and its frame into back, sidelength * sidelength bytes.
+    RETURNS 0 if it is a checkpoint of the export with frames still to come, -1 otherwise
+*/
+static int read_checkpoint(const char* path, uint64_t export, int sidelength, int nframes, Checkpoint* p_checkpoint, uint8_t* back)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) return -1;
+
+    size_t pixels = (size_t) sidelength * sidelength;
+    int valid = fread(p_checkpoint, sizeof(Checkpoint), 1, file) == 1 && fread(back, 1, pixels, file) == pixels;
+    fclose(file);
+
+    return valid && memcmp(p_checkpoint->magic, checkpoint_magic, sizeof(checkpoint_magic)) == 0 && p_checkpoint->export == export
+           && p_checkpoint->sidelength == sidelength && p_checkpoint->next > 0 && p_checkpoint->next < nframes && p_checkpoint->offset > 0 ? 0 : -1;
+}
+
+//----------------------------------//
+
+//RENDERS frames in order of index into the ring until there are none left
+static void gif_worker(void* arg, int index)
+{
+    Gif_Job* job = arg;
+
+    pthread_mutex_lock(&job->lock);
+
+    while(job->next_frame < job->nframes)
+    {
+        int frame = job->next_frame++;
+        int slot = frame % job->nslots;
+
+        //Wait for the encoder to empty the frame's slot
+        if(frame >= job->next_encode + job->nslots)
+        {
+            double start = seconds();
+            while(frame >= job->next_encode + job->nslots) pthread_cond_wait(&job->freed, &job->lock);
+            job->render_stall += seconds() - start;
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        Frame_Trace* trace = &job->traces[frame];
+        trace->thread = index;
+        trace->viewport_start = seconds() - job->start;
+        Coord max, mid;
+        gif_viewport(job->timeline, job->first + frame, &max, &mid);
+
+        trace->iterate_start = seconds() - job->start;
+        int reused = gif_frame(job->slots[slot], NULL, job->cache, job->timeline, job->first + frame, max, mid, job->mode);
+        trace->iterate_end = seconds() - job->start;
+        Precision precision = job->slots[slot]->precision;
+        trace->precision = precision;
+
+        pthread_mutex_lock(&job->lock);
+        job->precisions[precision]++;
+        job->reused += reused;
+        job->ready[slot] = frame;
+        if(frame == job->next_encode) pthread_cond_signal(&job->filled);
+    }
+
+    pthread_mutex_unlock(&job->lock);
+}
+
+//ENCODES the frames of the ring in order as they become ready, on its own thread
+static void* gif_encoder(void* arg)
+{
+    Gif_Job* job = arg;
+
+    pthread_mutex_lock(&job->lock);
+
+    while(job->next_encode < job->nframes)
+    {
+        int slot = job->next_encode % job->nslots;
+
+        if(job->ready[slot] != job->next_encode)
+        {
+            double start = seconds();
+            while(job->ready[slot] != job->next_encode) pthread_cond_wait(&job->filled, &job->lock);
+            job->encode_stall += seconds() - start;
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        Frame_Trace* trace = &job->traces[job->next_encode];
+
+        double start = seconds();
+        trace->encode_start = start - job->start;
+        gif_encode(job->gif, job->lut, job->slots[slot], job->mili_duration, trace);
+        double busy = seconds() - start;
+
+        //The last frame is followed by the trailer, and the checkpoint removed
+        if(job->checkpoint != NULL && job->next_encode + 1 < job->nframes && seconds() - job->last_checkpoint >= job->checkpoint_interval)
+        {
+            if(write_checkpoint(job->checkpoint, job->gif, job->export, job->first + job->next_encode + 1) != 0)
+            {
+                printf("\nCould not write a checkpoint to %s, carrying on without\n", job->checkpoint);
+                job->checkpoint = NULL;
+            }
+            job->last_checkpoint = seconds();
+        }
+
+        if(job->progress) print_progress(job, job->next_encode + 1);
+
+        pthread_mutex_lock(&job->lock);
+        job->encode_busy += busy;
+        job->ready[slot] = -1;
+        job->next_encode++;
+        pthread_cond_broadcast(&job->freed);
+    }
+
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/*
+    RETURNS a gif encoder writing to sink, with the palette of save_gif. With frames_only, the header is taken
+    as written already and only frames are written (see ge_new_fragment), after a comment extension if there is one
+*/
+static ge_GIF* new_gif(ge_Sink* sink, int sidelength, Gif_Options options, int frames_only, const char* comment)
+{
+    //Delta frames need one more index than the palette has for transparency, so the palette is doubled
+    int depth = options.delta ? PALETTE_DEPTH + 1 : PALETTE_DEPTH;
+
+    uint8_t palette[2 * PALETTE_SIZE * 3] = {0};
+    palette_rgb(palette);
+
+    ge_GIF* gif;
+
+    if(frames_only)
+    {
+        gif = ge_new_fragment(sink, sidelength, sidelength, depth, -1);
+        if(gif != NULL && comment != NULL) ge_add_comment(gif, comment);
+    }
+    else gif = ge_new_gif(sink, sidelength, sidelength, palette, depth, -1, 0);
+
+    if(gif == NULL) return NULL;
+
+    gif->transparent = options.delta ? PALETTE_SIZE : -1;
+    gif->max_rects = options.rects;
+    return gif;
+}
+
+/*
+    ENCODES frames first to last - 1 of the gif of the snapshots in timeline to sink, then closes it. Prints the
+    same as save_gif. RETURNS 0 once they (and any trace) are written, -1 otherwise
+
+    \param sink Where the gif is written, NULL if it could not be opened
+    \param name The name of the file sink writes, for the messages
+    \param comment NULL to write a whole gif. Otherwise only the frames are written, after a comment extension
+                   holding comment, encoded as if frame first - 1 came before them (see ge_skip_frame)
+    \param back NULL to start the gif as usual. Otherwise the gif up to frame first is in sink already, back
+                being the palette colours of its last frame, and is carried on from there (see save_gif)
+    The others are the same as for save_gif
+*/
+static int encode_gif(ge_Sink* sink, const char* name, int sidelength, const Timeline* timeline, int first, int last, Pool* p_pool, Gif_Options options, const char* comment, const uint8_t* back)
+{
+    ge_GIF* gif = new_gif(sink, sidelength, options, comment != NULL || back != NULL, comment);
+
+    if(gif == NULL)
+    {
+        if(sink != NULL) ge_sink_close(sink);
+        printf("Could not create %s. Returning to main menu\n", name);
+        return -1;
+    }
+
+    Gif_Job job;
+    job.gif = gif;
+    job.timeline = timeline;
+    job.sidelength = sidelength;
+    job.first = first;
+    job.nframes = last - first;
+    job.mode = options.mode;
+    job.cache = options.cache;
+    palette_lut(job.lut);
+
+    //The frame before a fragment is only rendered for the deltas of its first frame
+    if(back != NULL)
+    {
+        memcpy(gif->frame, back, (size_t) sidelength * sidelength);
+        ge_skip_frame(gif);
+    }
+    else if(comment != NULL && first > 0)
+    {
+        Iter_Buffer* buffer = newIterBuffer(sidelength, sidelength);
+        Coord max, mid;
+        gif_viewport(timeline, first - 1, &max, &mid);
+        gif_frame(buffer, p_pool, job.cache, timeline, first - 1, max, mid, job.mode);
+
+        for(long pixel = 0; pixel < (long) sidelength * sidelength; pixel++) gif->frame[pixel] = job.lut[buffer->iters[pixel]];
+        ge_skip_frame(gif);
+
+        deleteIterBuffer(buffer);
+    }
+
+    Cache_Stats before;
+    if(job.cache != NULL) before = cache_stats(job.cache);
+
+    //A gif of a single snapshot has a single, short frame
+    job.mili_duration = timeline->npanels == 1 ? 1 : (int) ((1.0 / FRAMERATE) * 1000);
+
+    job.nslots = SLOTS_PER_THREAD * pool_size(p_pool);
+    job.slots = (Iter_Buffer**) malloc(job.nslots * sizeof(Iter_Buffer*));
+    job.ready = (int*) malloc(job.nslots * sizeof(int));
+
+    for(int i = 0; i < job.nslots; i++)
+    {
+        job.slots[i] = newIterBuffer(sidelength, sidelength);
+        job.ready[i] = -1;
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.freed, NULL);
+    pthread_cond_init(&job.filled, NULL);
+    job.next_frame = 0;
+    job.next_encode = 0;
+    job.render_stall = job.encode_stall = job.encode_busy = 0;
+    for(int i = 0; i <= PRECISION_PERTURBATION; i++) job.precisions[i] = 0;
+    job.reused = 0;
+
+    job.traces = (Frame_Trace*) calloc(job.nframes, sizeof(Frame_Trace));
+    job.nthreads = pool_size(p_pool);
+    job.progress = options.progress;
+    job.last_progress = 0;
+
+    double start = seconds();
+    job.start = start;
+
+    //Only whole gifs written to a file are checkpointed, fragments resume on their own (see render_shard)
+    char checkpoint[SHARD_PATH];
+    checkpoint_path(checkpoint, sizeof(checkpoint), name);
+    int checkpointed = comment == NULL && options.checkpoint > 0 && sink->type == GE_SINK_FD;
+
+    job.checkpoint = checkpointed ? checkpoint : NULL;
+    job.checkpoint_interval = options.checkpoint;
+    job.last_checkpoint = start;
+    job.export = checkpointed ? export_hash(sidelength, timeline, options) : 0;
+
+    //Compression overlaps with rendering on a thread of its own
+    pthread_t encoder;
+    pthread_create(&encoder, NULL, gif_encoder, &job);
+
+    //One long-running task per thread, each claiming frames as it goes
+    pool_run(p_pool, pool_size(p_pool), gif_worker, &job);
+
+    pthread_join(encoder, NULL);
+
+    double total = seconds() - start;
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.freed);
+    pthread_cond_destroy(&job.filled);
+
+    for(int i = 0; i < job.nslots; i++) deleteIterBuffer(job.slots[i]);
+    free(job.slots);
+    free(job.ready);
+
+    if(comment != NULL) ge_close_fragment(gif);
+    else ge_close_gif(gif);
+
+    //Totals of every stage. The writes of the header and the last flushes are counted against the last frame
+    double viewport_time = 0, iterate_time = 0, palette_time = 0, rects_time = 0, lzw_time = 0, write_time = 0;
+    long iterations = 0;
+
+    for(int i = 0; i < job.nframes; i++)
+    {
+        Frame_Trace* trace = &job.traces[i];
+        viewport_time += trace->iterate_start - trace->viewport_start;
+        iterate_time += trace->iterate_end - trace->iterate_start;
+        palette_time += trace->palette;
+        rects_time += trace->rects;
+        lzw_time += trace->lzw;
+        write_time += trace->write;
+        iterations += trace->iterations;
+    }
+
+    if(job.nframes > 0) job.traces[job.nframes - 1].write += sink->emit_time - write_time;
+    write_time = sink->emit_time;
+
+    if(ge_sink_close(sink) != 0)
+    {
+        printf("Could not write all of %s\n", name);
+        free(job.traces);
+        return -1;
+    }
+
+    printf("%s created\n", name);
+
+    //Nothing is left to resume
+    if(checkpointed) remove(checkpoint);
+
+    //Whichever stage stalls less is the one limiting throughput
+    printf("%d frames in %.2fs. Render threads stalled %.2fs on average waiting for the encoder, "
+           "the encoder stalled %.2fs waiting for frames and was busy for %.2fs\n",
+           job.nframes, total, job.render_stall / pool_size(p_pool), job.encode_stall, job.encode_busy);
+
+    printf("Frames iterated in");
+    for(int i = 0; i <= PRECISION_PERTURBATION; i++)
+    {
+        if(job.precisions[i] > 0) printf(" %s: %d", precision_name(i), job.precisions[i]);
+    }
+    if(job.reused > 0) printf(", %d of them copied from the screen when their snapshot was taken", job.reused);
+    printf("\n");
+
+    if(job.cache != NULL)
+    {
+        Cache_Stats after = cache_stats(job.cache);
+        printf("Tiles taken from the cache: %ld, iterated: %ld\n", after.hits - before.hits, after.misses - before.misses);
+    }
+
+    long pixels = (long) job.nframes * sidelength * sidelength;
+    printf("Stages: viewport %.3fs and iterate %.2fs summed over the render threads, palette %.3fs, rectangles %.3fs, "
+           "LZW %.3fs, writes %.3fs\n", viewport_time, iterate_time, palette_time, rects_time, lzw_time, write_time);
+    printf("%ld iterations over %ld pixels, %.1f million iterations/s and %.2f megapixels/s\n",
+           iterations, pixels, iterations / total * 1e-6, pixels / total * 1e-6);
+
+    int status = 0;
+
+    if(options.trace != NULL && options.trace[0] != '\0')
+    {
+        if(write_trace(&job, options.trace) == 0) printf("Per-frame trace written to %s\n", options.trace);
+        else
+        {
+            printf("Could not write the trace to %s\n", options.trace);
+            status = -1;
+        }
+    }
+
+    free(job.traces);
+    return status;
+}
+
+static int save_gif_sharded(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options);
+
+int save_gif(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options)
+{
+    if(timeline->npanels == 0)
+    {
+        printf("No snapshots in the current gif. Returning to main menu\n");
+        return -1;
+    }
+
+    if(options.shards > 1) return save_gif_sharded(filename, sidelength, timeline, p_pool, options);
+
+    int nframes = timeline_frames(timeline);
+
+    //An export interrupted after a checkpoint carries on from it, the frames written after it being dropped
+    if(options.checkpoint > 0)
+    {
+        char path[SHARD_PATH];
+        checkpoint_path(path, sizeof(path), filename);
+
+        Checkpoint checkpoint;
+        uint8_t* back = (uint8_t*) malloc((size_t) sidelength * sidelength);
+        struct stat status;
+
+        if(read_checkpoint(path, export_hash(sidelength, timeline, options), sidelength, nframes, &checkpoint, back) == 0
+           && stat(filename, &status) == 0 && status.st_size >= checkpoint.offset)
+        {
+            printf("Resuming %s from its checkpoint at frame %d of %d\n", filename, checkpoint.next, nframes);
+            int result = encode_gif(ge_sink_resume(filename, checkpoint.offset), filename, sidelength, timeline, checkpoint.next, nframes, p_pool, options, NULL, back);
+            free(back);
+            return result;
+        }
+
+        free(back);
+    }
+
+    return encode_gif(ge_sink_file(filename), filename, sidelength, timeline, 0, nframes, p_pool, options, NULL, NULL);
+}
+
+//----------------------------------//
+
+//FINDS the frames first to last - 1 that shard renders
+static void shard_frames(const Timeline* timeline, int shard, int nshards, int* p_first, int* p_last)
+{
+    long nframes = timeline_frames(timeline);
+    *p_first = (int) (nframes * shard / nshards);
+    *p_last = (int) (nframes * (shard + 1) / nshards);
+}
+
+/*
+    WRITES the comment a fragment starts with into text, which holds SHARD_COMMENT characters. It names the
+    shard and its frames, and the export they belong to (see export_hash)
+*/
+static void shard_comment(char* text, int sidelength, const Timeline* timeline, Gif_Options options, int shard, int nshards)
+{
+    uint64_t hash = export_hash(sidelength, timeline, options);
+
+    int first, last;
+    shard_frames(timeline, shard, nshards, &first, &last);
+    snprintf(text, SHARD_COMMENT, "fractal_viewer shard %d of %d, frames %d to %d, export %016llx", shard, nshards, first, last, (unsigned long long) hash);
+}
+
+void shard_path(char* path, int length, const char* filename, int shard, int nshards)
+{
+    snprintf(path, length, "%s.%dof%d", filename, shard, nshards);
+}
+
+/*
+    READS the comment extension a fragment starts with into text, which holds SHARD_COMMENT characters.
+    RETURNS 0 on success, leaving file just after it, or -1 if the file does not start with one
+*/
+static int read_comment(FILE* file, char* text)
+{
+    if(fgetc(file) != '!' || fgetc(file) != 0xFE) return -1;
+
+    int length = 0;
+    int block;
+
+    while((block = fgetc(file)) > 0)
+    {
+        if(length + block >= SHARD_COMMENT || fread(text + length, 1, block, file) != (size_t) block) return -1;
+        length += block;
+    }
+
+    text[length] = '\0';
+    return block == 0 ? 0 : -1;
+}
+
+//RETURN whether the fragment at path was rendered in full for the export described by comment
+static int fragment_done(const char* path, const char* comment)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) return 0;
+
+    char text[SHARD_COMMENT];
+    int done = read_comment(file, text) == 0 && strcmp(text, comment) == 0;
+
+    fclose(file);
+    return done;
+}
+
+int render_shard(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options, int shard, int nshards)
+{
+    if(timeline->npanels == 0 || shard < 0 || shard >= nshards)
+    {
+        printf("No shard %d of %d to render\n", shard, nshards);
+        return -1;
+    }
+
+    char path[SHARD_PATH], temp[SHARD_PATH + 4], comment[SHARD_COMMENT];
+    shard_path(path, sizeof(path), filename, shard, nshards);
+    shard_comment(comment, sidelength, timeline, options, shard, nshards);
+
+    //Fragments only get their name once they are whole, so an interrupted shard is rendered again
+    if(fragment_done(path, comment))
+    {
+        printf("%s was already rendered\n", path);
+        return 0;
+    }
+
+    int first, last;
+    shard_frames(timeline, shard, nshards, &first, &last);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    int status = encode_gif(ge_sink_file(temp), path, sidelength, timeline, first, last, p_pool, options, comment, NULL);
+
+    if(status == 0 && rename(temp, path) != 0)
+    {
+        printf("Could not rename %s to %s\n", temp, path);
+        status = -1;
+    }
+
+    if(status != 0) remove(temp);
+    return status;
+}
+
+//COPIES the frames of the fragment at path to sink. RETURNS 0 on success, -1 if it is missing or not from the export of comment
+static int copy_fragment(ge_Sink* sink, const char* path, const char* comment)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) return -1;
+
+    char text[SHARD_COMMENT];
+
+    if(read_comment(file, text) != 0 || strcmp(text, comment) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    uint8_t* chunk = (uint8_t*) malloc(SHARD_CHUNK);
+    size_t length;
+
+    while((length = fread(chunk, 1, SHARD_CHUNK, file)) > 0) ge_sink_write(sink, chunk, length);
+
+    int status = ferror(file) ? -1 : 0;
+
+    free(chunk);
+    fclose(file);
+    return status;
+}
+
+int merge_shards(char* filename, int sidelength, const Timeline* timeline, Gif_Options options, int nshards)
+{
+    if(timeline->npanels == 0 || nshards < 1)
+    {
+        printf("No shards to merge\n");
+        return -1;
+    }
+
+    ge_Sink* sink = ge_sink_file(filename);
+    ge_GIF* gif = new_gif(sink, sidelength, options, 0, NULL);
+
+    if(gif == NULL)
+    {
+        if(sink != NULL) ge_sink_close(sink);
+        printf("Could not create %s\n", filename);
+        return -1;
+    }
+
+    char path[SHARD_PATH], comment[SHARD_COMMENT];
+    int status = 0;
+
+    for(int shard = 0; shard < nshards && status == 0; shard++)
+    {
+        shard_path(path, sizeof(path), filename, shard, nshards);
+        shard_comment(comment, sidelength, timeline, options, shard, nshards);
+
+        if(copy_fragment(sink, path, comment) != 0)
+        {
+            printf("%s is missing, incomplete or from another export. Render shard %d again\n", path, shard);
+            status = -1;
+        }
+    }
+
+    ge_close_gif(gif);
+    if(ge_sink_close(sink) != 0 && status == 0)
+    {
+        printf("Could not write all of %s\n", filename);
+        status = -1;
+    }
+
+    if(status != 0)
+    {
+        remove(filename);
+        return -1;
+    }
+
+    for(int shard = 0; shard < nshards; shard++)
+    {
+        shard_path(path, sizeof(path), filename, shard, nshards);
+        remove(path);
+    }
+
+    printf("%s merged from %d shards\n", filename, nshards);
+    return 0;
+}
+
+/*
+    RETURNS a copy of environ without trace, which every shard would write over, for the shards' processes.
+    Free the array, not its strings
+*/
+static char** shard_environment()
+{
+    int count = 0;
+    while(environ[count] != NULL) count++;
+
+    char** environment = (char**) malloc((count + 1) * sizeof(char*));
+    int length = strlen(TRACE_ENV), kept = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        if(strncmp(environ[i], TRACE_ENV, length) == 0 && environ[i][length] == '=') continue;
+        environment[kept++] = environ[i];
+    }
+
+    environment[kept] = NULL;
+    return environment;
+}
+
+/*
+    WRITES the path of this program's executable into path, which holds length characters: /proc/self/exe where
+    there is one, program otherwise, looked up on PATH if it names no directory. RETURNS 0 on success, -1 otherwise
+*/
+static int shard_program(char* path, int length, const char* program)
+{
+    if(access("/proc/self/exe", X_OK) == 0)
+    {
+        snprintf(path, length, "/proc/self/exe");
+        return 0;
+    }
+
+    if(program == NULL || program[0] == '\0') return -1;
+
+    if(strchr(program, '/') != NULL)
+    {
+        int written = snprintf(path, length, "%s", program);
+        return written < length && access(path, X_OK) == 0 ? 0 : -1;
+    }
+
+    //As a shell finds it. An empty entry is the current directory
+    const char* directories = getenv("PATH");
+    if(directories == NULL) return -1;
+
+    for(const char* start = directories;; start++)
+    {
+        const char* end = strchr(start, ':');
+        int size = end != NULL ? end - start : (int) strlen(start);
+
+        int written = size == 0 ? snprintf(path, length, "%s", program) : snprintf(path, length, "%.*s/%s", size, start, program);
+        if(written < length && access(path, X_OK) == 0) return 0;
+
+        if(end == NULL) return -1;
+        start = end;
+    }
+}
+
+static int save_gif_sharded(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options)
+{
+    int nshards = options.shards;
+
+    //The threads are split between the processes, which cannot share p_pool or the cache
+    int nthreads = pool_size(p_pool) / nshards;
+    if(nthreads < 1) nthreads = 1;
+
+    char program[SHARD_PATH];
+    if(shard_program(program, sizeof(program), options.program) != 0)
+    {
+        printf("Could not find this program to start the shards from\n");
+        return -1;
+    }
+
+    //The shards are handed the keyframes as a timeline file
+    char keyframes[SHARD_PATH];
+    snprintf(keyframes, sizeof(keyframes), "%s.timeline", filename);
+
+    if(timeline_save(timeline, keyframes) != 0)
+    {
+        printf("Could not write the keyframes to %s\n", keyframes);
+        return -1;
+    }
+
+    printf("Rendering %d shards of %s in %d processes of %d threads\n", nshards, filename, nshards, nthreads);
+
+    //Anything still buffered would be printed again by every process
+    fflush(stdout);
+
+    //The shards are rendered by the batch mode of this program (see run_batch), started afresh. A fork alone
+    //would copy this process with locks held by its other threads, which never run in the copy, so
+    //everything the child runs is set up beforehand and it only calls execve
+    const char* mode = options.mode == RENDER_SUBDIVIDE ? "subdivide" : options.mode == RENDER_PROGRESSIVE ? "progressive" : "brute";
+    char size[16], shards[16], threads[16], shard_name[16];
+    snprintf(size, sizeof(size), "%d", sidelength);
+    snprintf(shards, sizeof(shards), "%d", nshards);
+    snprintf(threads, sizeof(threads), "%d", nthreads);
+
+    char** environment = shard_environment();
+    pid_t* pids = (pid_t*) malloc(nshards * sizeof(pid_t));
+
+    for(int shard = 0; shard < nshards; shard++)
+    {
+        snprintf(shard_name, sizeof(shard_name), "%d", shard);
+
+        //Ends early with a cache, each process having one of its own
+        char* arguments[] = {"fractals_mb", "--output", filename, "--size", size, "--mode", (char*) mode, "--timeline", keyframes,
+                             "--shards", shards, "--shard", shard_name, "--threads", threads, "--quiet",
+                             options.cache != NULL ? NULL : "--no-cache", NULL};
+
+        pids[shard] = fork();
+
+        if(pids[shard] == 0)
+        {
+            execve(program, arguments, environment);
+            _exit(127);
+        }
+
+        if(pids[shard] < 0) printf("Could not start a process for shard %d\n", shard);
+    }
+
+    int failed = 0;
+
+    for(int shard = 0; shard < nshards; shard++)
+    {
+        int status = 1;
+        if(pids[shard] > 0) waitpid(pids[shard], &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+    }
+
+    free(pids);
+    free(environment);
+    remove(keyframes);
+
+    //The shards that finished are kept, so exporting again renders only the rest
+    if(failed > 0)
+    {
+        printf("%d of %d shards failed. Export again to render only those\n", failed, nshards);
+        return -1;
+    }
+
+    return merge_shards(filename, sidelength, timeline, options, nshards);
+}
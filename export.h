@@ -0,0 +1,133 @@
+#ifndef _EXPORT
+#define _EXPORT
+
+//Turns a path of snapshots into a gif
+
+#include "helper.h"
+#include "pool.h"
+#include "frame.h"
+#include "timeline.h"
+
+//The largest side length of a gif. Gifs hold it in 16 bits, and the pixels of a frame are numbered by ints (the
+//encoder sizes its two buffers in size_t, which at this side are over INT_MAX bytes together)
+#define GIF_MAX_SIZE 46340
+
+//Settings for save_gif
+typedef struct Gif_Options
+{
+    //Write pixels which did not change since the last frame as transparent, so they compress to long runs
+    int delta;
+
+    //Most rectangles each frame's changes may be split into. Only 1 keeps every frame's delay exact in all viewers
+    int rects;
+
+    //How the pixels of each frame are found
+    Render_Mode mode;
+
+    //Tiles are shared with this cache, eg the viewer's, NULL to iterate every frame in full
+    Cache* cache;
+
+    //Redraw a line with the frames done, frames/s and the time left as the gif is written
+    int progress;
+
+    //Where the time each frame spent in each stage is written, as Chrome trace JSON if it ends in .json
+    //and as CSV otherwise. NULL or empty to write none
+    const char* trace;
+
+    //The number of processes the frames are split between, each rendering a fragment (see render_shard).
+    //1 renders the gif in this process. Processes do not share the cache, and write no trace or progress.
+    //They run this program again in batch mode (see run_batch), so the program must start it when given arguments
+    int shards;
+
+    //The path the program was started by, argv[0], which shards are started from where /proc/self/exe is missing
+    //(it is on Linux only). Looked up on PATH if it has no '/'. NULL for none
+    const char* program;
+
+    //Seconds between checkpoints of a gif rendered in this process, 0 for none. An export stopped part way
+    //resumes from its last checkpoint when it is run again with the same settings (see save_gif)
+    double checkpoint;
+} Gif_Options;
+
+//Environment variable which sets the trace of gif_default_options
+#define TRACE_ENV "FRACTAL_TRACE"
+
+//Environment variable which sets the seconds between checkpoints of gif_default_options
+#define CHECKPOINT_ENV "FRACTAL_CHECKPOINT"
+
+//RETURN the default settings for save_gif, with the trace set by TRACE_ENV and the checkpoints by CHECKPOINT_ENV
+Gif_Options gif_default_options();
+
+/*
+    FINDS the view of frame index of the gif of the snapshots in timeline. Each frame is computed
+    straight from its index, so frames can be rendered in any order.
+
+    \param timeline The snapshots, see timeline_find
+    \param index The frame, starting at 0. Assumes index < timeline_frames(timeline)
+    \param p_max Where the largest coordinate of the frame is stored
+    \param p_mid Where the coordinate at the centre of the frame is stored
+*/
+void gif_viewport(const Timeline* timeline, int index, Coord* p_max, Coord* p_mid);
+
+/*
+    RENDERS the escape counts of one frame of the gif into buffer, see render_buffer
+    RETURNS the precision the frame was iterated in. With a cache, mid is moved onto its grid first (see snap_mid)
+    Warning: max.real:max.imag :: 1:1, otherwise the fractal will be stretched/compressed
+
+    \param buffer Where the escape counts are written, sidelength by sidelength
+    \param p_pool The thread pool the escape counts are computed on, NULL to use the calling thread
+    \param p_cache The cache tiles are looked up in and stored to, NULL to iterate every tile
+    \param max The largest coordinate on the screen
+    \param mid The coordinate at the centre of the screen
+    \param mode How the pixels of the frame are found
+*/
+Precision gif_render(Iter_Buffer* buffer, Pool* p_pool, Cache* p_cache, Coord max, Coord mid, Render_Mode mode);
+
+/*
+    Renders the gif specified by the snapshots in timeline. Several frames are rendered at once,
+    one per thread, into a ring of 2 frames per thread. A separate encoder thread compresses
+    and writes them in order. Prints progress as it goes, then how long each stage spent stalled on the
+    other and where the time went: viewports, iteration, palette mapping, finding the changed rectangles,
+    LZW compression and writes.
+    With options.shards above 1, the frames are rendered by that many processes instead and merged (see
+    render_shard and merge_shards). The fragments of shards that finished are kept if any fails, so
+    exporting again renders only the rest.
+    With options.checkpoint, the encoder records every so many seconds where the last frame written ends in the
+    file and what it shows, in filename.checkpoint. Exporting the same gif again cuts the file back to there and
+    carries on from the next frame, giving the same gif as an export which was never stopped.
+    RETURNS 0 once the whole gif (and any trace) is written, -1 if there was nothing to write or it could not be written
+
+    \param filename The filename of the gif
+    \param sidelength The sidelength of the gif, from 1 to GIF_MAX_SIZE
+    \param timeline The snapshots to be rendered
+    \param p_pool The thread pool the frames are computed on
+    \param options How the frames are encoded
+*/
+int save_gif(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options);
+
+//WRITES the path of the fragment of shard out of nshards of the gif filename into path, which holds length characters
+void shard_path(char* path, int length, const char* filename, int shard, int nshards);
+
+/*
+    RENDERS one contiguous share of the frames of the gif into a fragment file at shard_path: the frames
+    only, after a comment naming the export, with deltas taken against the last frame of the shard before.
+    Shards can be rendered in any order, by any process or machine sharing the filesystem.
+    A fragment is only given its name once it is complete, and one already rendered for the same export is
+    kept, so rendering a shard again resumes it.
+    RETURNS 0 once the fragment is written, -1 otherwise
+
+    \param shard Which share of the frames is rendered, from 0 to nshards - 1
+    \param nshards The number of shares the frames are split into
+    The others are the same as for save_gif
+*/
+int render_shard(char* filename, int sidelength, const Timeline* timeline, Pool* p_pool, Gif_Options options, int shard, int nshards);
+
+/*
+    JOINS the fragments of every shard into the gif filename behind its header, then removes them.
+    RETURNS 0 on success, -1 after naming a fragment that is missing or belongs to another export
+
+    \param nshards The number of shares the frames were split into
+    The others are the same as for render_shard
+*/
+int merge_shards(char* filename, int sidelength, const Timeline* timeline, Gif_Options options, int nshards);
+
+#endif // #ifndef _EXPORT
@@ -0,0 +1,732 @@
+#include "frame.h"
+#include "deep.h"
+
+#include <string.h>
+
+//Everything a tile needs to render itself
+typedef struct Frame_Job
+{
+    uint16_t* iters;
+    int width;
+    int height;
+    int band_y; //The row of the view held in the first row of iters
+
+    //The part of the frame being rendered, split into tiles_x tiles across
+    int area_x;
+    int area_y;
+    int area_w;
+    int area_h;
+    int tiles_x;
+
+    //How far the first tile starts before the area, so the tiles line up with the grid (see render_job)
+    int shift_x;
+    int shift_y;
+    Coord max;
+    Coord mid;
+    Coord scale;
+    Precision precision;
+    Render_Mode mode;
+    int pass; //The spacing of the progressive pass being rendered, 0 to render every pixel
+    const uint8_t* known; //Pixels already holding their counts are non-zero, NULL if none are
+
+    //The reference orbit of mid for views iterated by perturbation, NULL otherwise
+    Orbit* orbit;
+
+    //Whole tiles are looked up in and stored to cache, NULL when the view is not on the cache's grid
+    Cache* cache;
+    long long origin_x; //The column of pixel 0 on the grid of every view with this scale
+    long long origin_y;
+} Frame_Job;
+
+//A view is on the cache's grid when pixel 0 is this close to a whole number of pixels from the origin
+#define GRID_TOLERANCE 1e-3L
+
+//Views further than this many pixels from the origin are never cached, the columns no longer fit
+#define GRID_LIMIT 0x1p62L
+
+//A rectangle of pixels, borders included
+typedef struct Frame_Rect
+{
+    int x;
+    int y;
+    int w;
+    int h;
+} Frame_Rect;
+
+//The most rectangles subdivide_tile can have waiting at once
+#define SUBDIVIDE_RECTS (TILE_SIZE * TILE_SIZE / 4)
+
+const char* render_mode_name(Render_Mode mode)
+{
+    if(mode == RENDER_SUBDIVIDE) return "subdivision";
+    if(mode == RENDER_PROGRESSIVE) return "progressive";
+    return "brute force";
+}
+
+//RENDERS count pixels of row pixel_y, starting from pixel_x
+static void render_span(Frame_Job* job, int pixel_x, int pixel_y, int count)
+{
+    uint16_t* out = job->iters + (long) pixel_y * job->width + pixel_x;
+
+    //The offset from mid of the leftmost point of the row
+    Coord offset;
+    offset.real = -job->max.real;
+    offset.imag = (job->band_y + pixel_y) * job->scale.imag - job->max.imag;
+
+    if(job->orbit != NULL) deep_row(job->orbit, out, count, offset, job->scale.real, pixel_x, BASE_ITERATIONS);
+    else escape_row(out, count, job->mid, offset, job->scale.real, pixel_x, job->precision, BASE_ITERATIONS);
+}
+
+//RENDERS the listed pixels, given as indices into iters, iterating each at most budget times. They match the pixels render_span would give
+static void render_budget(Frame_Job* job, const int* pixels, int count, int budget)
+{
+    //A tile may list none, leaving pixels unset
+    if(count == 0) return;
+
+    //The offset from mid of the top left pixel of the view
+    Coord offset;
+    offset.real = -job->max.real;
+    offset.imag = -job->max.imag;
+
+    if(job->orbit != NULL) deep_pixels(job->orbit, job->iters, job->width, job->band_y, pixels, count, offset, job->scale, budget);
+    else escape_pixels(job->iters, job->width, job->band_y, pixels, count, job->mid, offset, job->scale, job->precision, budget);
+}
+
+//RENDERS the listed pixels with the base budget
+static void render_pixels(Frame_Job* job, const int* pixels, int count)
+{
+    render_budget(job, pixels, count, BASE_ITERATIONS);
+}
+
+/*
+    RAISES the iteration budget of a tile on the boundary of the set. The pixels that reached the base budget
+    are iterated again with a larger one, doubled for as long as each round lets more of them escape and it
+    stays within MAX_ITERATIONS. A tile is on the boundary when some pixels escaped close to the base budget,
+    or when its border pixels that reached it escape once given MAX_ITERATIONS, eg on deep views where every
+    pixel needs more. Tiles well inside or outside the set stay at the base budget
+*/
+static void deepen_tile(Frame_Job* job, int x, int y, int w, int h)
+{
+    int pixels[TILE_SIZE * TILE_SIZE];
+    int border[4 * TILE_SIZE];
+    int count = 0, nborder = 0;
+    uint16_t highest = 0;
+
+    for(int pixel_y = y; pixel_y < y + h; pixel_y++)
+    {
+        for(int pixel_x = x; pixel_x < x + w; pixel_x++)
+        {
+            int pixel = pixel_y * job->width + pixel_x;
+            uint16_t value = job->iters[pixel];
+
+            //Counts carried over from another view may have been deepened there, they start again from the base budget
+            if(value > BASE_ITERATIONS) value = job->iters[pixel] = 0;
+
+            if(value > highest) highest = value;
+            if(value != 0) continue;
+
+            if(pixel_y == y || pixel_y == y + h - 1 || pixel_x == x || pixel_x == x + w - 1) border[nborder++] = pixel;
+            else pixels[count++] = pixel;
+        }
+    }
+
+    if(count + nborder == 0) return;
+
+    //Border pixels that never escape are left out of the rounds, they would not escape in any of them
+    if(highest <= BASE_ITERATIONS / 2)
+    {
+        render_budget(job, border, nborder, MAX_ITERATIONS);
+
+        int escaped = 0;
+        for(int i = 0; i < nborder; i++)
+        {
+            if(job->iters[border[i]] > highest) highest = job->iters[border[i]];
+            escaped += job->iters[border[i]] != 0;
+        }
+
+        if(escaped == 0) return;
+    }
+    else
+    {
+        memcpy(pixels + count, border, nborder * sizeof(int));
+        count += nborder;
+    }
+
+    //The first round starts with room above the highest count already seen
+    int budget = 2 * BASE_ITERATIONS;
+    while(budget < 2 * highest && budget < MAX_ITERATIONS) budget *= 2;
+
+    for(; budget <= MAX_ITERATIONS && count > 0; budget *= 2)
+    {
+        render_budget(job, pixels, count, budget);
+
+        int left = 0;
+        for(int i = 0; i < count; i++)
+        {
+            if(job->iters[pixels[i]] == 0) pixels[left++] = pixels[i];
+        }
+
+        if(left == count) return;
+        count = left;
+    }
+}
+
+//RETURN whether every pixel on the border of the rectangle has the same escape count
+static int uniform_border(Frame_Job* job, Frame_Rect rect)
+{
+    uint16_t* top = job->iters + (long) rect.y * job->width + rect.x;
+    uint16_t* bottom = top + (long) (rect.h - 1) * job->width;
+    uint16_t value = top[0];
+
+    for(int i = 0; i < rect.w; i++)
+    {
+        if(top[i] != value || bottom[i] != value) return 0;
+    }
+
+    for(int i = 1; i < rect.h - 1; i++)
+    {
+        if(top[(long) i * job->width] != value || top[(long) i * job->width + rect.w - 1] != value) return 0;
+    }
+
+    return 1;
+}
+
+//ADDS the pixels of the w by h block at (x, y) to the count already in pixels, RETURNS the new count
+static int add_block(Frame_Job* job, int* pixels, int count, int x, int y, int w, int h)
+{
+    for(int pixel_y = y; pixel_y < y + h; pixel_y++)
+    {
+        for(int pixel_x = x; pixel_x < x + w; pixel_x++) pixels[count++] = pixel_y * job->width + pixel_x;
+    }
+    return count;
+}
+
+/*
+    RENDERS a tile by Mariani-Silver subdivision. A rectangle whose border has one escape count is filled
+    with it, otherwise it is split in four along a cross and each quarter is done the same way. Every
+    rectangle waiting is handled in the same round, so the kernels are given long runs of points at once
+*/
+static void subdivide_tile(Frame_Job* job, int x, int y, int w, int h)
+{
+    int pixels[TILE_SIZE * TILE_SIZE];
+    Frame_Rect rects[2][SUBDIVIDE_RECTS];
+
+    //Each tile renders its own border, so tiles never wait on each other
+    int count = add_block(job, pixels, 0, x, y, w, 1);
+    count = add_block(job, pixels, count, x, y + h - 1, w, 1);
+    count = add_block(job, pixels, count, x, y + 1, 1, h - 2);
+    count = add_block(job, pixels, count, x + w - 1, y + 1, 1, h - 2);
+    render_pixels(job, pixels, count);
+
+    Frame_Rect tile = {x, y, w, h};
+    rects[0][0] = tile;
+
+    int current = 0;
+    int nrects = 1;
+
+    while(nrects > 0)
+    {
+        Frame_Rect* next = rects[!current];
+        int nnext = 0;
+        count = 0;
+
+        for(int i = 0; i < nrects; i++)
+        {
+            Frame_Rect rect = rects[current][i];
+
+            if(rect.w < 3 || rect.h < 3) continue;
+
+            if(uniform_border(job, rect))
+            {
+                uint16_t value = job->iters[(long) rect.y * job->width + rect.x];
+
+                for(int pixel_y = rect.y + 1; pixel_y < rect.y + rect.h - 1; pixel_y++)
+                {
+                    uint16_t* row = job->iters + (long) pixel_y * job->width;
+                    for(int pixel_x = rect.x + 1; pixel_x < rect.x + rect.w - 1; pixel_x++) row[pixel_x] = value;
+                }
+                continue;
+            }
+
+            if(rect.w <= SUBDIVIDE_MIN || rect.h <= SUBDIVIDE_MIN)
+            {
+                count = add_block(job, pixels, count, rect.x + 1, rect.y + 1, rect.w - 2, rect.h - 2);
+                continue;
+            }
+
+            //The quarters share the cross between them as borders
+            int mid_x = rect.x + rect.w / 2;
+            int mid_y = rect.y + rect.h / 2;
+
+            count = add_block(job, pixels, count, rect.x + 1, mid_y, rect.w - 2, 1);
+            count = add_block(job, pixels, count, mid_x, rect.y + 1, 1, mid_y - rect.y - 1);
+            count = add_block(job, pixels, count, mid_x, mid_y + 1, 1, rect.y + rect.h - mid_y - 2);
+
+            Frame_Rect quarters[4] = {
+                {rect.x, rect.y, mid_x - rect.x + 1, mid_y - rect.y + 1},
+                {mid_x, rect.y, rect.x + rect.w - mid_x, mid_y - rect.y + 1},
+                {rect.x, mid_y, mid_x - rect.x + 1, rect.y + rect.h - mid_y},
+                {mid_x, mid_y, rect.x + rect.w - mid_x, rect.y + rect.h - mid_y}
+            };
+            for(int q = 0; q < 4; q++) next[nnext++] = quarters[q];
+        }
+
+        render_pixels(job, pixels, count);
+
+        current = !current;
+        nrects = nnext;
+    }
+}
+
+//RENDERS one progressive pass of a tile, see render_pass
+static void pass_tile(Frame_Job* job, int x, int y, int w, int h)
+{
+    int pixels[TILE_SIZE * TILE_SIZE];
+    int count = 0;
+    int step = job->pass;
+
+    for(int pixel_y = y; pixel_y < y + h; pixel_y += step)
+    {
+        for(int pixel_x = x; pixel_x < x + w; pixel_x += step)
+        {
+            //Already iterated by the pass before
+            if(step < PROGRESSIVE_STEP && pixel_x % (2 * step) == 0 && pixel_y % (2 * step) == 0) continue;
+
+            pixels[count++] = pixel_y * job->width + pixel_x;
+        }
+    }
+
+    render_pixels(job, pixels, count);
+
+    if(step == 1) return;
+
+    //Each new pixel stands in for the block it starts until a finer pass reaches it
+    for(int i = 0; i < count; i++)
+    {
+        int pixel_x = pixels[i] % job->width;
+        int pixel_y = pixels[i] / job->width;
+        int right = pixel_x + step < x + w ? pixel_x + step : x + w;
+        int bottom = pixel_y + step < y + h ? pixel_y + step : y + h;
+
+        for(int block_y = pixel_y; block_y < bottom; block_y++)
+        {
+            uint16_t* row = job->iters + (long) block_y * job->width;
+            for(int block_x = pixel_x; block_x < right; block_x++) row[block_x] = job->iters[pixels[i]];
+        }
+    }
+}
+
+//RENDERS the pixels of a tile not marked in job->known
+static void known_tile(Frame_Job* job, int x, int y, int w, int h)
+{
+    int pixels[TILE_SIZE * TILE_SIZE];
+    int count = 0;
+
+    for(int pixel_y = y; pixel_y < y + h; pixel_y++)
+    {
+        for(int pixel_x = x; pixel_x < x + w; pixel_x++)
+        {
+            int pixel = pixel_y * job->width + pixel_x;
+            if(!job->known[pixel]) pixels[count++] = pixel;
+        }
+    }
+
+    render_pixels(job, pixels, count);
+}
+
+//RENDERS the w by h block at (x, y) by the mode of job
+static void render_block(Frame_Job* job, int x, int y, int w, int h)
+{
+    if(job->known != NULL) known_tile(job, x, y, w, h);
+    else if(job->pass > 0) pass_tile(job, x, y, w, h);
+    else if(job->mode == RENDER_SUBDIVIDE && w >= 3 && h >= 3) subdivide_tile(job, x, y, w, h);
+    else
+    {
+        for(int pixel_y = y; pixel_y < y + h; pixel_y++) render_span(job, x, pixel_y, w);
+    }
+
+    //Coarse passes only hold some of the tile's pixels, the last one holds them all
+    if(job->pass <= 1) deepen_tile(job, x, y, w, h);
+}
+
+static void render_tile(void* arg, int index)
+{
+    Frame_Job* job = arg;
+
+    //Tiles on the edges of the area are clipped to it
+    int x = job->area_x - job->shift_x + (index % job->tiles_x) * TILE_SIZE;
+    int y = job->area_y - job->shift_y + (index / job->tiles_x) * TILE_SIZE;
+    int right = x + TILE_SIZE < job->area_x + job->area_w ? x + TILE_SIZE : job->area_x + job->area_w;
+    int bottom = y + TILE_SIZE < job->area_y + job->area_h ? y + TILE_SIZE : job->area_y + job->area_h;
+    if(x < job->area_x) x = job->area_x;
+    if(y < job->area_y) y = job->area_y;
+
+    //Only whole tiles are cached, clipped ones are always iterated
+    if(job->cache == NULL || right - x < TILE_SIZE || bottom - y < TILE_SIZE)
+    {
+        render_block(job, x, y, right - x, bottom - y);
+        return;
+    }
+
+    Tile_Key key;
+    key.scale_real = job->scale.real;
+    key.scale_imag = job->scale.imag;
+    key.x = (job->origin_x + x) / TILE_SIZE;
+    key.y = (job->origin_y + y) / TILE_SIZE;
+
+    //Subdivision can fill over features brute force would find, so it never shares tiles with it
+    key.variant = 2 * job->precision + (job->mode == RENDER_SUBDIVIDE);
+
+    uint16_t* tile = job->iters + (long) y * job->width + x;
+
+    if(cache_get(job->cache, key, tile, job->width, TILE_SIZE)) return;
+
+    render_block(job, x, y, TILE_SIZE, TILE_SIZE);
+    cache_put(job->cache, key, tile, job->width, TILE_SIZE);
+}
+
+//RETURN the remainder of a divided by b, never negative (b > 0)
+static long long floor_mod(long long a, int b)
+{
+    return ((a % b) + b) % b;
+}
+
+/*
+    FINDS the column and row of pixel 0 on the grid shared by every view with the same pixel spacing, to the
+    nearest pixel. Both are 0 for views too far out for the grid. RETURNS 0 if the view is not on the grid
+*/
+static int grid_origin(Coord scale, Coord max, Coord mid, long long* p_x, long long* p_y)
+{
+    long double x = (mid.real - max.real) / scale.real;
+    long double y = (mid.imag - max.imag) / scale.imag;
+
+    *p_x = *p_y = 0;
+    if(!(fabsl(x) < GRID_LIMIT && fabsl(y) < GRID_LIMIT)) return 0;
+
+    *p_x = llroundl(x);
+    *p_y = llroundl(y);
+    return fabsl(x - *p_x) <= GRID_TOLERANCE && fabsl(y - *p_y) <= GRID_TOLERANCE;
+}
+
+int tile_row(int width, int height, Coord max, Coord mid)
+{
+    Coord scale;
+    scale.real = 2 * max.real / width;
+    scale.imag = 2 * max.imag / height;
+
+    long long x, y;
+    grid_origin(scale, max, mid, &x, &y);
+    return floor_mod(-y, TILE_SIZE);
+}
+
+Coord snap_mid(int width, int height, Coord max, Coord mid)
+{
+    Coord scale;
+    scale.real = 2 * max.real / width;
+    scale.imag = 2 * max.imag / height;
+
+    long double x = (mid.real - max.real) / scale.real;
+    long double y = (mid.imag - max.imag) / scale.imag;
+
+    //Too far out for the grid, and far enough that moving less than a pixel would not help
+    if(!(fabsl(x) < GRID_LIMIT && fabsl(y) < GRID_LIMIT)) return mid;
+
+    Coord snapped;
+    snapped.real = roundl(x) * scale.real + max.real;
+    snapped.imag = roundl(y) * scale.imag + max.imag;
+    return snapped;
+}
+
+Precision frame_precision(int width, int height, Coord max, Coord mid)
+{
+    //The same precision is used for the whole frame, so neighbouring tiles always agree
+    long double magnitude = fmaxl(fabsl(mid.real) + fabsl(max.real), fabsl(mid.imag) + fabsl(max.imag));
+    long double step = fminl(fabsl(2 * max.real / width), fabsl(2 * max.imag / height));
+    return escape_precision(magnitude, step);
+}
+
+/*
+    RENDERS the w by h block at pixel (x, y) in tiles over pool, as a progressive pass of spacing pass unless it is 0.
+    iters holds band_h rows of the view from band_y down
+*/
+static Precision render_job(Pool* pool, Cache* cache, uint16_t* iters, const uint8_t* known, int width, int height, Coord max, Coord mid, Render_Mode mode, int pass, int band_y, int band_h, int x, int y, int w, int h)
+{
+    Frame_Job job;
+    job.iters = iters;
+    job.width = width;
+    job.height = height;
+    job.max = max;
+    job.mid = mid;
+    job.mode = mode;
+    job.pass = pass;
+    job.known = known;
+
+    //Each pixel is scale units apart (cartesian units/pixel)
+    job.scale.real = 2 * max.real / width;
+    job.scale.imag = 2 * max.imag / height;
+
+    job.precision = frame_precision(width, height, max, mid);
+
+    //Tiles lie on the grid, so a pan moves them along with the picture. The blocks of coarse progressive
+    //passes have to start on multiples of the pass, so those keep to the tiles of the view instead
+    long long origin_x, origin_y;
+    int on_grid = grid_origin(job.scale, max, mid, &origin_x, &origin_y);
+    if(pass > 1) origin_x = origin_y = 0;
+
+    //A boundary tile's budget depends on all of its pixels, so the block grows to the whole tiles it touches
+    if(pass <= 1)
+    {
+        int right = x + w, bottom = y + h;
+        x -= floor_mod(origin_x + x, TILE_SIZE);
+        y -= floor_mod(origin_y + y, TILE_SIZE);
+        right += floor_mod(-(origin_x + right), TILE_SIZE);
+        bottom += floor_mod(-(origin_y + bottom), TILE_SIZE);
+
+        //Tiles on the edges of the view or band are cut by them
+        if(x < 0) x = 0;
+        if(y < band_y) y = band_y;
+        if(right > width) right = width;
+        if(bottom > band_y + band_h) bottom = band_y + band_h;
+        w = right - x;
+        h = bottom - y;
+    }
+
+    job.area_x = x;
+    job.area_w = w;
+    job.area_h = h;
+    job.shift_x = floor_mod(origin_x + x, TILE_SIZE);
+    job.shift_y = floor_mod(origin_y + y, TILE_SIZE);
+
+    //Perturbation counts depend on the reference orbit of mid, so they are never shared between views
+    job.cache = NULL;
+
+    if(cache != NULL && pass == 0 && job.precision != PRECISION_PERTURBATION && on_grid)
+    {
+        job.cache = cache;
+        job.origin_x = origin_x;
+        job.origin_y = origin_y + band_y;
+    }
+
+    //Rows are counted from the top of iters from here on
+    job.band_y = band_y;
+    job.area_y = y - band_y;
+
+    job.tiles_x = (job.shift_x + w + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (job.shift_y + h + TILE_SIZE - 1) / TILE_SIZE;
+
+    //Too deep even for double-doubles, so every pixel is iterated as an offset from mid
+    job.orbit = NULL;
+    if(job.precision == PRECISION_PERTURBATION)
+    {
+        job.orbit = newOrbit(mid, max, fminl(fabsl(job.scale.real), fabsl(job.scale.imag)), MAX_ITERATIONS, 1);
+    }
+
+    if(pool == NULL)
+    {
+        for(int index = 0; index < job.tiles_x * tiles_y; index++) render_tile(&job, index);
+    }
+    else pool_run(pool, job.tiles_x * tiles_y, render_tile, &job);
+
+    if(job.orbit != NULL) deleteOrbit(job.orbit);
+
+    return job.precision;
+}
+
+Precision render_region(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode, int x, int y, int w, int h)
+{
+    return render_job(pool, cache, iters, NULL, width, height, max, mid, mode, 0, 0, height, x, y, w, h);
+}
+
+Precision render_pass(Pool* pool, uint16_t* iters, int width, int height, Coord max, Coord mid, int step, int x, int y, int w, int h)
+{
+    return render_job(pool, NULL, iters, NULL, width, height, max, mid, RENDER_PROGRESSIVE, step, 0, height, x, y, w, h);
+}
+
+Precision render_frame(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode)
+{
+    return render_region(pool, cache, iters, width, height, max, mid, mode, 0, 0, width, height);
+}
+
+Precision render_band(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode, int y, int h)
+{
+    return render_job(pool, cache, iters, NULL, width, height, max, mid, mode, 0, y, h, 0, y, width, h);
+}
+
+/*
+    FINDS, for each pixel along one axis of the new view, the nearest pixel of the old view, and whether
+    their centres are the same point. RETURNS how many are
+
+    \param nearest Where the nearest old pixel of each new one is written, clamped to the frame
+    \param exact Where 1 is written for each new pixel that is exactly on an old one, 0 otherwise
+    \param moved How far the centre moved, new minus old
+*/
+static int resample_axis(int* nearest, uint8_t* exact, int length, long double moved, long double from_max, long double max)
+{
+    long double from_scale = 2 * from_max / length;
+    long double scale = 2 * max / length;
+    int count = 0;
+
+    for(int i = 0; i < length; i++)
+    {
+        //Every term is about the size of the view, so the difference keeps its precision on deep views
+        long double position = (moved + (i * scale - max) + from_max) / from_scale;
+        long double rounded = roundl(position);
+
+        nearest[i] = rounded < 0 ? 0 : rounded > length - 1 ? length - 1 : (int) rounded;
+        exact[i] = rounded == nearest[i] && fabsl(position - rounded) < GRID_TOLERANCE;
+        count += exact[i];
+    }
+
+    return count;
+}
+
+long resample_frame(const uint16_t* from, uint16_t* iters, uint8_t* known, int width, int height, Coord from_max, Coord from_mid, Coord max, Coord mid)
+{
+    int* columns = (int*) malloc(width * sizeof(int));
+    int* rows = (int*) malloc(height * sizeof(int));
+    uint8_t* exact_columns = (uint8_t*) malloc(width);
+    uint8_t* exact_rows = (uint8_t*) malloc(height);
+
+    int ncolumns = resample_axis(columns, exact_columns, width, mid.real - from_mid.real, from_max.real, max.real);
+    int nrows = resample_axis(rows, exact_rows, height, mid.imag - from_mid.imag, from_max.imag, max.imag);
+
+    //Counts iterated in another precision would not match the pixels around them
+    int same = frame_precision(width, height, from_max, from_mid) == frame_precision(width, height, max, mid);
+
+    for(int y = 0; y < height; y++)
+    {
+        const uint16_t* source = from + (long) rows[y] * width;
+        uint16_t* row = iters + (long) y * width;
+        uint8_t* known_row = known + (long) y * width;
+
+        for(int x = 0; x < width; x++)
+        {
+            row[x] = source[columns[x]];
+            known_row[x] = same && exact_rows[y] && exact_columns[x];
+        }
+    }
+
+    free(columns);
+    free(rows);
+    free(exact_columns);
+    free(exact_rows);
+
+    return same ? (long) ncolumns * nrows : 0;
+}
+
+Precision refine_frame(Pool* pool, uint16_t* iters, const uint8_t* known, int width, int height, Coord max, Coord mid)
+{
+    //No cache, as a tile holding known counts from another view would be stored without them being iterated
+    return render_job(pool, NULL, iters, known, width, height, max, mid, RENDER_BRUTE_FORCE, 0, 0, height, 0, 0, width, height);
+}
+
+Precision pan_frame(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord from_mid, Coord mid, Render_Mode mode, int dx, int dy)
+{
+    Coord scale;
+    scale.real = 2 * max.real / width;
+    scale.imag = 2 * max.imag / height;
+
+    //Pixel 0 of each view, in pixels from the origin of the grid
+    long double before_x = (from_mid.real - max.real) / scale.real, before_y = (from_mid.imag - max.imag) / scale.imag;
+    long double after_x = (mid.real - max.real) / scale.real, after_y = (mid.imag - max.imag) / scale.imag;
+
+    //The kept counts only still belong to their pixels if the view really moved by dx, dy pixels. Too far out for
+    //the grid a pixel is below the precision of mid, which then moves by some other amount, or not at all
+    int moved = fabsl(after_x) < GRID_LIMIT && fabsl(after_y) < GRID_LIMIT
+        && fabsl(before_x - dx - after_x) <= GRID_TOLERANCE && fabsl(before_y - dy - after_y) <= GRID_TOLERANCE;
+
+    //The kept counts were deepened tile by tile, so the tiles of the two views have to line up
+    long long column, row, column_before, row_before;
+    grid_origin(scale, max, mid, &column, &row);
+    grid_origin(scale, max, from_mid, &column_before, &row_before);
+    int aligned = floor_mod(column_before - dx - column, TILE_SIZE) == 0 && floor_mod(row_before - dy - row, TILE_SIZE) == 0;
+
+    //Nothing left to reuse, or the old counts were iterated differently
+    if(abs(dx) >= width || abs(dy) >= height || !moved || !aligned || frame_precision(width, height, max, from_mid) != frame_precision(width, height, max, mid))
+    {
+        return render_frame(pool, cache, iters, width, height, max, mid, mode);
+    }
+
+    //Pixel (x, y) now shows what pixel (x - dx, y - dy) showed
+    int rows = height - abs(dy);
+    int columns = width - abs(dx);
+    int from_x = dx > 0 ? 0 : -dx, to_x = dx > 0 ? dx : 0;
+    int from_y = dy > 0 ? 0 : -dy, to_y = dy > 0 ? dy : 0;
+
+    //Rows are moved in the order that never overwrites one still waiting to be moved
+    for(int i = 0; i < rows; i++)
+    {
+        int row = dy > 0 ? rows - 1 - i : i;
+        memmove(iters + (long) (to_y + row) * width + to_x, iters + (long) (from_y + row) * width + from_x, columns * sizeof(uint16_t));
+    }
+
+    //The strips uncovered along each edge
+    Precision precision = frame_precision(width, height, max, mid);
+
+    if(dy != 0) render_region(pool, cache, iters, width, height, max, mid, mode, 0, dy > 0 ? 0 : height + dy, width, abs(dy));
+    if(dx != 0) render_region(pool, cache, iters, width, height, max, mid, mode, dx > 0 ? 0 : width + dx, to_y, abs(dx), rows);
+
+    //Tiles cut by the edge across from a strip held more of their pixels in the old view, so they are rendered again
+    if(dy > 0 && floor_mod(row + height, TILE_SIZE) != 0) render_region(pool, cache, iters, width, height, max, mid, mode, 0, height - 1, width, 1);
+    if(dy < 0 && floor_mod(row, TILE_SIZE) != 0) render_region(pool, cache, iters, width, height, max, mid, mode, 0, 0, width, 1);
+    if(dx > 0 && floor_mod(column + width, TILE_SIZE) != 0) render_region(pool, cache, iters, width, height, max, mid, mode, width - 1, 0, 1, height);
+    if(dx < 0 && floor_mod(column, TILE_SIZE) != 0) render_region(pool, cache, iters, width, height, max, mid, mode, 0, 0, 1, height);
+
+    return precision;
+}
+
+//----------------------------------//
+
+Iter_Buffer* newIterBuffer(int width, int height)
+{
+    Iter_Buffer* buffer = (Iter_Buffer*) calloc(1, sizeof(Iter_Buffer));
+    buffer->iters = (uint16_t*) calloc((long) width * height, sizeof(uint16_t));
+    buffer->width = width;
+    buffer->height = height;
+    buffer->complete = 0;
+    return buffer;
+}
+
+Iter_Buffer* copyIterBuffer(const Iter_Buffer* buffer)
+{
+    Iter_Buffer* copy = (Iter_Buffer*) malloc(sizeof(Iter_Buffer));
+    copy->iters = (uint16_t*) malloc((long) buffer->width * buffer->height * sizeof(uint16_t));
+    fill_buffer(copy, buffer);
+    return copy;
+}
+
+void deleteIterBuffer(Iter_Buffer* buffer)
+{
+    free(buffer->iters);
+    free(buffer);
+}
+
+void fill_buffer(Iter_Buffer* buffer, const Iter_Buffer* from)
+{
+    uint16_t* iters = buffer->iters;
+    *buffer = *from;
+    buffer->iters = iters;
+    memcpy(iters, from->iters, (long) from->width * from->height * sizeof(uint16_t));
+}
+
+Precision render_buffer(Pool* pool, Cache* cache, Iter_Buffer* buffer, Coord max, Coord mid, Render_Mode mode)
+{
+    buffer->precision = render_frame(pool, cache, buffer->iters, buffer->width, buffer->height, max, mid, mode);
+    buffer->max = max;
+    buffer->mid = mid;
+    buffer->mode = mode;
+    buffer->complete = 1;
+    return buffer->precision;
+}
+
+int buffer_holds(const Iter_Buffer* buffer, int width, int height, Coord max, Coord mid, Render_Mode mode)
+{
+    if(buffer == NULL || !buffer->complete || buffer->width != width || buffer->height != height) return 0;
+    if((buffer->mode == RENDER_SUBDIVIDE) != (mode == RENDER_SUBDIVIDE)) return 0;
+
+    //The edges of the two views are within the tolerance of each other
+    long double real = fabsl(buffer->mid.real - mid.real) + fabsl(buffer->max.real - max.real);
+    long double imag = fabsl(buffer->mid.imag - mid.imag) + fabsl(buffer->max.imag - max.imag);
+
+    return real <= GRID_TOLERANCE * fabsl(2 * max.real / width) && imag <= GRID_TOLERANCE * fabsl(2 * max.imag / height);
+}
@@ -0,0 +1,199 @@
+#ifndef _FRAME
+#define _FRAME
+
+//Renders whole frames of escape counts, split into tiles over a thread pool
+
+#include "helper.h"
+#include "pool.h"
+#include "escape.h"
+#include "cache.h"
+
+//The sidelength of the square tiles a frame is split into
+#define TILE_SIZE 32
+
+//Rectangles this thin or thinner are no longer subdivided, their insides are iterated pixel by pixel
+#define SUBDIVIDE_MIN 4
+
+//How the pixels of a tile are found
+typedef enum Render_Mode
+{
+    RENDER_BRUTE_FORCE, //Every pixel is iterated
+    RENDER_SUBDIVIDE, //Mariani-Silver: rectangles whose whole border has one escape count are filled without iterating
+    RENDER_PROGRESSIVE //Every pixel is iterated, on screen in coarse-to-fine passes (render_pass). A single call renders like brute force
+} Render_Mode;
+
+//The first pass of progressive rendering iterates one pixel in every PROGRESSIVE_STEP by PROGRESSIVE_STEP block
+#define PROGRESSIVE_STEP 8
+
+//RETURN a name for mode to show in the log
+const char* render_mode_name(Render_Mode mode);
+
+//The escape counts of a whole view in row major order, with the view they belong to. The screen and the gif both render into these
+typedef struct Iter_Buffer
+{
+    uint16_t* iters;
+    int width;
+    int height;
+
+    //The view the counts belong to, and how they were found
+    Coord max;
+    Coord mid;
+    Render_Mode mode;
+    Precision precision;
+    int complete; //0 until the counts are those of the view, eg while iters holds blocks of a progressive render that was dropped
+} Iter_Buffer;
+
+//RETURN a buffer of width * height counts holding no view yet
+Iter_Buffer* newIterBuffer(int width, int height);
+
+//RETURN a copy of buffer and its counts
+Iter_Buffer* copyIterBuffer(const Iter_Buffer* buffer);
+
+//FREES buffer and its counts
+void deleteIterBuffer(Iter_Buffer* buffer);
+
+//COPIES the counts of from and the view they belong to into buffer, which is of the same size
+void fill_buffer(Iter_Buffer* buffer, const Iter_Buffer* from);
+
+/*
+    RENDERS the view into buffer with render_frame and records it as the view the buffer holds.
+    RETURNS the precision it was iterated in
+
+    \param buffer Where the counts are written, of the size of the frame
+    The others are the same as for render_frame
+*/
+Precision render_buffer(Pool* pool, Cache* cache, Iter_Buffer* buffer, Coord max, Coord mid, Render_Mode mode);
+
+/*
+    RETURNS whether buffer holds the counts render_buffer would give the view, so they need not be iterated again.
+    Views less than a thousandth of a pixel apart count as the same, as for the cache. Counts found by subdivision
+    only stand in for subdivision, and those of the other modes (which agree) only for each other
+
+    \param buffer The buffer which might hold the view, NULL if there is none
+    The others are the same as for render_frame
+*/
+int buffer_holds(const Iter_Buffer* buffer, int width, int height, Coord max, Coord mid, Render_Mode mode);
+
+/*
+    FILLS iters with the escape counts of every pixel in the view, in row major order.
+    RETURNS the precision the view was iterated in, the cheapest that still tells its pixels apart.
+    The output is the same whatever the number of threads in pool, or with no pool at all.
+    With a cache, whole tiles are taken from it when a view with the same pixel spacing rendered them before.
+    Only views on the grid of snap_mid share tiles, and views iterated by perturbation never do.
+    A cached tile was iterated from another centre, so a pixel on the edge of an escape band can be one count off.
+    RENDER_SUBDIVIDE assumes a region enclosed by one escape count holds nothing else, so tiny features can be filled over.
+    Every pixel is given BASE_ITERATIONS. Tiles on the boundary of the set give the pixels that did not escape more,
+    doubling up to MAX_ITERATIONS while it finds more escaping, so deep views keep their detail. The tiles lie on
+    the grid of snap_mid (to the nearest pixel) whether or not the view is on it, so a pixel gets the same count
+    from every view it is in at this pixel spacing, however the views are split into tiles.
+    Warning: max.real:max.imag :: width:height, otherwise the fractal will be stretched/compressed
+
+    \param pool The pool the tiles are rendered on, NULL to render them all on the calling thread
+    \param cache The cache tiles are looked up in and stored to, NULL to iterate every tile
+    \param iters Where the escape counts are written, width * height entries long
+    \param width The width of the frame in pixels
+    \param height The height of the frame in pixels
+    \param max The largest coordinate on the screen
+    \param mid The coordinate at the centre of the screen
+    \param mode How the pixels of each tile are found
+*/
+Precision render_frame(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode);
+
+/*
+    RENDERS the w by h block of the view at pixel (x, y), the same counts render_frame would give it. The rest
+    of every tile the block touches is rendered along with it, as a boundary tile is deepened as a whole.
+    RETURNS the precision it was iterated in
+
+    \param x The leftmost column of the block
+    \param y The first row of the block
+    \param w The width of the block in pixels
+    \param h The height of the block in pixels
+    The others are the same as for render_frame
+*/
+Precision render_region(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode, int x, int y, int w, int h);
+
+/*
+    RENDERS rows y to y + h - 1 of the view into iters, which holds only those rows, so a view too large to
+    hold in memory can be rendered a band at a time. The rows get the counts render_frame would give them as
+    long as the band starts and ends where rows of tiles do (see tile_row) or at the edges of the view, since
+    boundary tiles are deepened (and subdivided) as a whole.
+    RETURNS the precision the view is iterated in, the same for every band
+
+    \param iters Where the escape counts of the band are written, width * h entries long
+    \param y The first row of the band
+    \param h The number of rows in the band
+    The others are the same as for render_frame
+*/
+Precision render_band(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord mid, Render_Mode mode, int y, int h);
+
+/*
+    MOVES a rendered frame by a whole number of pixels and renders only the strips uncovered along its edges,
+    and the tiles cut by the edges across from them, which the old view held more of.
+    The counts are only kept when mid is dx, dy pixels from from_mid, to within a thousandth of a pixel, so
+    they still belong to their pixels. Otherwise, as for views too far out for the grid of snap_mid, where a
+    pixel is below the precision of mid, the frame is rendered in full. RETURNS the precision the frame was iterated in
+
+    \param iters The escape counts of the view before the pan, updated in place
+    \param from_mid The coordinate at the centre of the view before the pan, which iters was rendered at
+    \param mid The coordinate at the centre of the view after the pan
+    \param dx How many pixels the picture moves right, pixel x shows what pixel x - dx showed
+    \param dy How many pixels the picture moves down the rows, pixel y shows what pixel y - dy showed
+    The others are the same as for render_frame
+*/
+Precision pan_frame(Pool* pool, Cache* cache, uint16_t* iters, int width, int height, Coord max, Coord from_mid, Coord mid, Render_Mode mode, int dx, int dy);
+
+/*
+    FILLS iters with a preview of a view resampled from the counts of another view of the same size, eg the
+    one before a zoom, taking the nearest old pixel for each new one. The pixels whose centre is exactly on
+    an old pixel's (when both views are iterated in the same precision) already hold their true count and
+    are marked in known. RETURNS how many pixels are marked
+
+    \param from The escape counts of the old view
+    \param iters Where the preview is written, width * height entries long
+    \param known Where 1 is written for each pixel holding its true count and 0 for the rest, width * height entries long
+    \param from_max The largest coordinate of the old view
+    \param from_mid The coordinate at the centre of the old view
+    \param max The largest coordinate of the new view
+    \param mid The coordinate at the centre of the new view
+*/
+long resample_frame(const uint16_t* from, uint16_t* iters, uint8_t* known, int width, int height, Coord from_max, Coord from_mid, Coord max, Coord mid);
+
+/*
+    RENDERS every pixel of the view not marked in known, iterating each one. After resample_frame this leaves
+    the same counts as render_frame in brute force.
+    RETURNS the precision the view was iterated in
+
+    \param known The pixels which already hold their true count are non-zero, eg from resample_frame
+    The others are the same as for render_frame
+*/
+Precision refine_frame(Pool* pool, uint16_t* iters, const uint8_t* known, int width, int height, Coord max, Coord mid);
+
+/*
+    RENDERS one pass of progressive rendering over the w by h block at pixel (x, y), which must lie on the
+    grid of the first pass unless step is 1. The last pass, like render_region, renders the rest of every tile
+    the block touches, so its blocks are best started on the rows of tile_row. Pass step iterates the pixels in every step-th row and column, except those the
+    pass before it (2 * step) already did, and paints each one over the step by step block below and right
+    of it. Passes of PROGRESSIVE_STEP, ..., 2, 1 in turn leave the same counts as render_frame.
+    RETURNS the precision the pass was iterated in
+
+    \param step The spacing of the pass, a power of 2 no larger than PROGRESSIVE_STEP
+    The others are the same as for render_region
+*/
+Precision render_pass(Pool* pool, uint16_t* iters, int width, int height, Coord max, Coord mid, int step, int x, int y, int w, int h);
+
+//RETURN the first row of the view at which a row of tiles starts, from 0 to TILE_SIZE - 1. Rows of tiles follow every TILE_SIZE rows
+int tile_row(int width, int height, Coord max, Coord mid);
+
+//RETURN the precision a view is iterated in, the cheapest that still tells its pixels apart
+Precision frame_precision(int width, int height, Coord max, Coord mid);
+
+/*
+    RETURNS the centre nearest mid that puts the view on the grid shared by every view with the same
+    pixel spacing, so its tiles can be shared through a cache. Moves the view by at most half a pixel
+
+    \param mid The coordinate at the centre of the screen, before snapping
+    The others are the same as for render_frame
+*/
+Coord snap_mid(int width, int height, Coord max, Coord mid);
+
+#endif // #ifndef _FRAME
@@ -1,8 +1,10 @@
 #include "gifenc.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -11,9 +13,15 @@
 #else
 #include <unistd.h>
 #endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* size of the userspace buffer in front of every sink */
+#define SINK_BUFSIZE 0x10000
 
 /* helper to write a little-endian 16-bit number portably */
-#define write_num(fd, n) write((fd), (uint8_t []) {(n) & 0xFF, (n) >> 8}, 2)
+#define write_num(sink, n) sink_write((sink), (uint8_t []) {(n) & 0xFF, (n) >> 8}, 2)
 
 static uint8_t vga[0x30] = {
     0x00, 0x00, 0x00,
@@ -34,82 +42,300 @@ static uint8_t vga[0x30] = {
     0xFF, 0xFF, 0xFF,
 };
 
-struct Node {
-    uint16_t key;
-    struct Node *children[];
-};
-typedef struct Node Node;
+/* The LZW dictionary is an open-addressing hash table from (prefix code,
+ * pixel) to code. Each entry packs the stamp of the code table it belongs
+ * to in its top 32 bits, then the 20-bit (prefix, pixel) key, then the
+ * 12-bit code. Entries with an old stamp count as empty, so starting a new
+ * code table is a single increment. At most 4096 codes against 8192 slots
+ * keeps the probe sequences short. */
+#define LZW_BITS 13
+#define LZW_SIZE (1 << LZW_BITS)
+
+static void
+lzw_reset(ge_GIF *gif)
+{
+    if (++gif->lzw_stamp == 0) {
+        memset(gif->lzw, 0, LZW_SIZE * sizeof(*gif->lzw));
+        gif->lzw_stamp = 1;
+    }
+}
 
-static Node *
-new_node(uint16_t key, int degree)
+static uint32_t
+lzw_slot(uint32_t key)
 {
-    Node *node = calloc(1, sizeof(*node) + degree * sizeof(Node *));
-    if (node)
-        node->key = key;
-    return node;
+    return (key * 2654435761u) >> (32 - LZW_BITS);
 }
 
-static Node *
-new_trie(int degree, int *nkeys)
+/* Return the code for prefix followed by pixel, or -1 if there is none. */
+static int
+lzw_find(ge_GIF *gif, uint16_t prefix, uint8_t pixel)
 {
-    Node *root = new_node(0, degree);
-    /* Create nodes for single pixels. */
-    for (*nkeys = 0; *nkeys < degree; (*nkeys)++)
-        root->children[*nkeys] = new_node(*nkeys, degree);
-    *nkeys += 2; /* skip clear code and stop code */
-    return root;
+    uint32_t key = ((uint32_t) prefix << 8) | pixel;
+    uint32_t i = lzw_slot(key);
+    uint64_t entry;
+    for (;; i = (i + 1) & (LZW_SIZE - 1)) {
+        entry = gif->lzw[i];
+        if ((uint32_t) (entry >> 32) != gif->lzw_stamp)
+            return -1;
+        if (((entry >> 12) & 0xFFFFF) == key)
+            return entry & 0xFFF;
+    }
 }
 
 static void
-del_trie(Node *root, int degree)
+lzw_add(ge_GIF *gif, uint16_t prefix, uint8_t pixel, uint16_t code)
 {
-    if (!root)
-        return;
-    for (int i = 0; i < degree; i++)
-        del_trie(root->children[i], degree);
-    free(root);
+    uint32_t key = ((uint32_t) prefix << 8) | pixel;
+    uint32_t i = lzw_slot(key);
+    while ((uint32_t) (gif->lzw[i] >> 32) == gif->lzw_stamp)
+        i = (i + 1) & (LZW_SIZE - 1);
+    gif->lzw[i] = ((uint64_t) gif->lzw_stamp << 32) | (key << 12) | code;
 }
 
-#define write_and_store(s, dst, fd, src, n) \
+#define write_and_store(s, dst, sink, src, n) \
 do { \
-    write(fd, src, n); \
+    sink_write(sink, src, n); \
     if (s) { \
         memcpy(dst, src, n); \
         dst += n; \
     } \
 } while (0);
 
+static ge_Sink *
+new_sink(int type)
+{
+    ge_Sink *sink = calloc(1, sizeof(*sink) + SINK_BUFSIZE);
+    if (!sink)
+        return NULL;
+    sink->type = type;
+    sink->flush = GE_FLUSH_FULL;
+    sink->fd = -1;
+    sink->buf = (uint8_t *) &sink[1];
+    sink->bufsize = SINK_BUFSIZE;
+    return sink;
+}
+
+ge_Sink *
+ge_sink_fd(int fd)
+{
+    ge_Sink *sink = new_sink(GE_SINK_FD);
+    if (sink)
+        sink->fd = fd;
+    return sink;
+}
+
+ge_Sink *
+ge_sink_file(const char *fname)
+{
+    ge_Sink *sink;
+    int fd;
+#ifdef _WIN32
+    fd = creat(fname, S_IWRITE);
+#else
+    fd = creat(fname, 0666);
+#endif
+    if (fd == -1)
+        return NULL;
+#ifdef _WIN32
+    setmode(fd, O_BINARY);
+#endif
+    sink = ge_sink_fd(fd);
+    if (!sink) {
+        close(fd);
+        return NULL;
+    }
+    sink->own_fd = 1;
+    return sink;
+}
+
+/* Reopen a file written before and carry on at offset, dropping whatever
+ * follows it, eg the frames of an export that was interrupted. */
+ge_Sink *
+ge_sink_resume(const char *fname, long long offset)
+{
+    ge_Sink *sink;
+    int fd;
+    fd = open(fname, O_WRONLY);
+    if (fd == -1)
+        return NULL;
+#ifdef _WIN32
+    setmode(fd, O_BINARY);
+    if (_chsize_s(fd, offset) != 0 || _lseeki64(fd, offset, SEEK_SET) == -1) {
+#else
+    if (ftruncate(fd, offset) == -1 || lseek(fd, offset, SEEK_SET) == -1) {
+#endif
+        close(fd);
+        return NULL;
+    }
+    sink = ge_sink_fd(fd);
+    if (!sink) {
+        close(fd);
+        return NULL;
+    }
+    sink->own_fd = 1;
+    sink->offset = offset;
+    return sink;
+}
+
+ge_Sink *
+ge_sink_memory(void)
+{
+    return new_sink(GE_SINK_MEMORY);
+}
+
+ge_Sink *
+ge_sink_callback(ge_WriteFn write, void *ctx)
+{
+    ge_Sink *sink = new_sink(GE_SINK_CALLBACK);
+    if (sink) {
+        sink->write = write;
+        sink->ctx = ctx;
+    }
+    return sink;
+}
+
+/* Monotonic time in seconds, for the stage timings, so a clock change cannot skew them. */
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Hand n bytes straight to the sink's destination, bypassing the buffer. */
+static void
+sink_emit(ge_Sink *sink, const uint8_t *data, size_t n)
+{
+    ssize_t done;
+    size_t cap;
+    uint8_t *mem;
+    double start;
+
+    if (sink->error || !n)
+        return;
+    start = now();
+    switch (sink->type) {
+    case GE_SINK_FD:
+        while (n) {
+            done = write(sink->fd, data, n);
+            if (done < 0) {
+                if (errno == EINTR)
+                    continue;
+                sink->error = 1;
+                return;
+            }
+            data += done;
+            n -= done;
+        }
+        break;
+    case GE_SINK_MEMORY:
+        if (sink->size + n > sink->cap) {
+            cap = sink->cap ? sink->cap : SINK_BUFSIZE;
+            while (cap < sink->size + n)
+                cap *= 2;
+            mem = realloc(sink->mem, cap);
+            if (!mem) {
+                sink->error = 1;
+                return;
+            }
+            sink->mem = mem;
+            sink->cap = cap;
+        }
+        memcpy(sink->mem + sink->size, data, n);
+        sink->size += n;
+        break;
+    case GE_SINK_CALLBACK:
+        if (sink->write(sink->ctx, data, n))
+            sink->error = 1;
+        break;
+    }
+    sink->emit_time += now() - start;
+}
+
+static void
+sink_write(ge_Sink *sink, const void *data, size_t n)
+{
+    sink->offset += n;
+    if (sink->len + n > sink->bufsize) {
+        ge_sink_flush(sink);
+        if (n >= sink->bufsize) {
+            sink_emit(sink, data, n);
+            return;
+        }
+    }
+    memcpy(sink->buf + sink->len, data, n);
+    sink->len += n;
+}
+
+/* Append bytes to the output, eg the frames of a fragment. */
+void
+ge_sink_write(ge_Sink *sink, const void *data, size_t n)
+{
+    sink_write(sink, data, n);
+}
+
+/* Return 0 if everything written so far reached the destination. */
+int
+ge_sink_flush(ge_Sink *sink)
+{
+    sink_emit(sink, sink->buf, sink->len);
+    sink->len = 0;
+    return sink->error ? -1 : 0;
+}
+
+/* Flush, close the file descriptor if the sink opened it and free the sink.
+ * A memory sink's output (mem, size) must be taken before this. */
+int
+ge_sink_close(ge_Sink *sink)
+{
+    int ret = ge_sink_flush(sink);
+    if (sink->own_fd && close(sink->fd))
+        ret = -1;
+    free(sink->mem);
+    free(sink);
+    return ret;
+}
+
 static void put_loop(ge_GIF *gif, uint16_t loop);
 
+/* Allocate an encoder writing to sink, with nothing written yet. */
+static ge_GIF *
+alloc_gif(ge_Sink *sink, uint16_t width, uint16_t height, int bgindex)
+{
+    int nbuffers = bgindex < 0 ? 2 : 1;
+    ge_GIF *gif;
+    if (!sink)
+        return NULL;
+    gif = calloc(1, sizeof(*gif) + LZW_SIZE*sizeof(*gif->lzw) + (size_t) nbuffers*width*height);
+    if (!gif)
+        return NULL;
+    gif->w = width; gif->h = height;
+    gif->bgindex = bgindex;
+    gif->lzw = (uint64_t *) &gif[1];
+    gif->frame = (uint8_t *) &gif->lzw[LZW_SIZE];
+    gif->back = &gif->frame[width*height];
+    gif->sink = sink;
+    gif->transparent = -1;
+    gif->max_rects = 1;
+    return gif;
+}
+
 ge_GIF *
 ge_new_gif(
-    const char *fname, uint16_t width, uint16_t height,
+    ge_Sink *sink, uint16_t width, uint16_t height,
     uint8_t *palette, int depth, int bgindex, int loop
 )
 {
     int i, r, g, b, v;
     int store_gct, custom_gct;
-    int nbuffers = bgindex < 0 ? 2 : 1;
-    ge_GIF *gif = calloc(1, sizeof(*gif) + nbuffers*width*height);
+    ge_GIF *gif;
+    gif = alloc_gif(sink, width, height, bgindex);
     if (!gif)
         goto no_gif;
-    gif->w = width; gif->h = height;
-    gif->bgindex = bgindex;
-    gif->frame = (uint8_t *) &gif[1];
-    gif->back = &gif->frame[width*height];
-#ifdef _WIN32
-    gif->fd = creat(fname, S_IWRITE);
-#else
-    gif->fd = creat(fname, 0666);
-#endif
-    if (gif->fd == -1)
-        goto no_fd;
-#ifdef _WIN32
-    setmode(gif->fd, O_BINARY);
-#endif
-    write(gif->fd, "GIF89a", 6);
-    write_num(gif->fd, width);
-    write_num(gif->fd, height);
+    sink_write(gif->sink, "GIF89a", 6);
+    write_num(gif->sink, width);
+    write_num(gif->sink, height);
     store_gct = custom_gct = 0;
     if (palette) {
         if (depth < 0)
@@ -120,18 +346,18 @@ ge_new_gif(
     if (depth < 0)
         depth = -depth;
     gif->depth = depth > 1 ? depth : 2;
-    write(gif->fd, (uint8_t []) {0xF0 | (depth-1), (uint8_t) bgindex, 0x00}, 3);
+    sink_write(gif->sink, (uint8_t []) {0xF0 | (depth-1), (uint8_t) bgindex, 0x00}, 3);
     if (custom_gct) {
-        write(gif->fd, palette, 3 << depth);
+        sink_write(gif->sink, palette, 3 << depth);
     } else if (depth <= 4) {
-        write_and_store(store_gct, palette, gif->fd, vga, 3 << depth);
+        write_and_store(store_gct, palette, gif->sink, vga, 3 << depth);
     } else {
-        write_and_store(store_gct, palette, gif->fd, vga, sizeof(vga));
+        write_and_store(store_gct, palette, gif->sink, vga, sizeof(vga));
         i = 0x10;
         for (r = 0; r < 6; r++) {
             for (g = 0; g < 6; g++) {
                 for (b = 0; b < 6; b++) {
-                    write_and_store(store_gct, palette, gif->fd,
+                    write_and_store(store_gct, palette, gif->sink,
                       ((uint8_t []) {r*51, g*51, b*51}), 3
                     );
                     if (++i == 1 << depth)
@@ -141,7 +367,7 @@ ge_new_gif(
         }
         for (i = 1; i <= 24; i++) {
             v = i * 0xFF / 25;
-            write_and_store(store_gct, palette, gif->fd,
+            write_and_store(store_gct, palette, gif->sink,
               ((uint8_t []) {v, v, v}), 3
             );
         }
@@ -150,20 +376,30 @@ done_gct:
     if (loop >= 0 && loop <= 0xFFFF)
         put_loop(gif, (uint16_t) loop);
     return gif;
-no_fd:
-    free(gif);
 no_gif:
     return NULL;
 }
 
+ge_GIF *
+ge_new_fragment(ge_Sink *sink, uint16_t width, uint16_t height, int depth, int bgindex)
+{
+    ge_GIF *gif = alloc_gif(sink, width, height, bgindex);
+    if (!gif)
+        return NULL;
+    if (depth < 0)
+        depth = -depth;
+    gif->depth = depth > 1 ? depth : 2;
+    return gif;
+}
+
 static void
 put_loop(ge_GIF *gif, uint16_t loop)
 {
-    write(gif->fd, (uint8_t []) {'!', 0xFF, 0x0B}, 3);
-    write(gif->fd, "NETSCAPE2.0", 11);
-    write(gif->fd, (uint8_t []) {0x03, 0x01}, 2);
-    write_num(gif->fd, loop);
-    write(gif->fd, "\0", 1);
+    sink_write(gif->sink, (uint8_t []) {'!', 0xFF, 0x0B}, 3);
+    sink_write(gif->sink, "NETSCAPE2.0", 11);
+    sink_write(gif->sink, (uint8_t []) {0x03, 0x01}, 2);
+    write_num(gif->sink, loop);
+    sink_write(gif->sink, "\0", 1);
 }
 
 /* Add packed key to buffer, updating offset and partial.
@@ -180,8 +416,8 @@ put_key(ge_GIF *gif, uint16_t key, int key_size)
     while (bits_to_write >= 8) {
         gif->buffer[byte_offset++] = gif->partial & 0xFF;
         if (byte_offset == 0xFF) {
-            write(gif->fd, "\xFF", 1);
-            write(gif->fd, gif->buffer, 0xFF);
+            sink_write(gif->sink, "\xFF", 1);
+            sink_write(gif->sink, gif->buffer, 0xFF);
             byte_offset = 0;
         }
         gif->partial >>= 8;
@@ -198,114 +434,265 @@ end_key(ge_GIF *gif)
     if (gif->offset % 8)
         gif->buffer[byte_offset++] = gif->partial & 0xFF;
     if (byte_offset) {
-        write(gif->fd, (uint8_t []) {byte_offset}, 1);
-        write(gif->fd, gif->buffer, byte_offset);
+        sink_write(gif->sink, (uint8_t []) {byte_offset}, 1);
+        sink_write(gif->sink, gif->buffer, byte_offset);
     }
-    write(gif->fd, "\0", 1);
+    sink_write(gif->sink, "\0", 1);
     gif->offset = gif->partial = 0;
 }
 
+/* With delta set, pixels equal to the back buffer are written as the
+ * transparent index, so they show the previous frame through. */
 static void
-put_image(ge_GIF *gif, uint16_t w, uint16_t h, uint16_t x, uint16_t y)
+put_image(ge_GIF *gif, uint16_t w, uint16_t h, uint16_t x, uint16_t y, int delta)
 {
-    int nkeys, key_size, i, j;
-    Node *node, *child, *root;
+    int nkeys, key_size, i, j, code, prefix;
     int degree = 1 << gif->depth;
 
-    write(gif->fd, ",", 1);
-    write_num(gif->fd, x);
-    write_num(gif->fd, y);
-    write_num(gif->fd, w);
-    write_num(gif->fd, h);
-    write(gif->fd, (uint8_t []) {0x00, gif->depth}, 2);
-    root = node = new_trie(degree, &nkeys);
+    sink_write(gif->sink, ",", 1);
+    write_num(gif->sink, x);
+    write_num(gif->sink, y);
+    write_num(gif->sink, w);
+    write_num(gif->sink, h);
+    sink_write(gif->sink, (uint8_t []) {0x00, gif->depth}, 2);
+    lzw_reset(gif);
+    nkeys = degree + 2; /* single pixels, then clear code and stop code */
     key_size = gif->depth + 1;
     put_key(gif, degree, key_size); /* clear code */
+    prefix = -1;
     for (i = y; i < y+h; i++) {
         for (j = x; j < x+w; j++) {
             uint8_t pixel = gif->frame[i*gif->w+j] & (degree - 1);
-            child = node->children[pixel];
-            if (child) {
-                node = child;
+            if (delta && gif->frame[i*gif->w+j] == gif->back[i*gif->w+j])
+                pixel = gif->transparent;
+            if (prefix < 0) {
+                prefix = pixel;
+                continue;
+            }
+            code = lzw_find(gif, prefix, pixel);
+            if (code >= 0) {
+                prefix = code;
             } else {
-                put_key(gif, node->key, key_size);
+                put_key(gif, prefix, key_size);
                 if (nkeys < 0x1000) {
                     if (nkeys == (1 << key_size))
                         key_size++;
-                    node->children[pixel] = new_node(nkeys++, degree);
+                    lzw_add(gif, prefix, pixel, nkeys++);
                 } else {
                     put_key(gif, degree, key_size); /* clear code */
-                    del_trie(root, degree);
-                    root = node = new_trie(degree, &nkeys);
+                    lzw_reset(gif);
+                    nkeys = degree + 2;
                     key_size = gif->depth + 1;
                 }
-                node = root->children[pixel];
+                prefix = pixel;
             }
         }
     }
-    put_key(gif, node->key, key_size);
+    put_key(gif, prefix, key_size);
     put_key(gif, degree + 1, key_size); /* stop code */
     end_key(gif);
-    del_trie(root, degree);
 }
 
+typedef struct Rect {
+    int x, y, w, h;
+} Rect;
+
+/* Byte n of the row being compared against: the back buffer, or bgindex. */
+#define BACK(b, c, n) ((b) ? (b)[n] : (c))
+
+/* Return the first index below n where a differs from b (or from the byte
+ * c if b is NULL), or n if there is none. Compares 16 bytes at a time. */
 static int
-get_bbox(ge_GIF *gif, uint16_t *w, uint16_t *h, uint16_t *x, uint16_t *y)
-{
-    int i, j, k;
-    int left, right, top, bottom;
-    uint8_t back;
-    left = gif->w; right = 0;
-    top = gif->h; bottom = 0;
-    k = 0;
+first_diff(const uint8_t *a, const uint8_t *b, uint8_t c, int n)
+{
+    int j = 0;
+#ifdef __SSE2__
+    __m128i fill = _mm_set1_epi8((char) c);
+    for (; j + 16 <= n; j += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *) &a[j]);
+        __m128i vb = b ? _mm_loadu_si128((const __m128i *) &b[j]) : fill;
+        int same = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+        if (same != 0xFFFF)
+            return j + __builtin_ctz(~same & 0xFFFF);
+    }
+#else
+    uint64_t wa, wb, fill = 0x0101010101010101ull * c;
+    for (; j + 8 <= n; j += 8) {
+        memcpy(&wa, &a[j], 8);
+        if (b)
+            memcpy(&wb, &b[j], 8);
+        else
+            wb = fill;
+        if (wa != wb)
+            break;
+    }
+#endif
+    for (; j < n; j++)
+        if (a[j] != BACK(b, c, j))
+            break;
+    return j;
+}
+
+/* Return the last index below n where a differs from b (or from c), or -1. */
+static int
+last_diff(const uint8_t *a, const uint8_t *b, uint8_t c, int n)
+{
+    int j = n;
+#ifdef __SSE2__
+    __m128i fill = _mm_set1_epi8((char) c);
+    for (; j >= 16; j -= 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *) &a[j-16]);
+        __m128i vb = b ? _mm_loadu_si128((const __m128i *) &b[j-16]) : fill;
+        int same = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+        if (same != 0xFFFF)
+            return j - 16 + 31 - __builtin_clz(~same & 0xFFFF);
+    }
+#else
+    uint64_t wa, wb, fill = 0x0101010101010101ull * c;
+    for (; j >= 8; j -= 8) {
+        memcpy(&wa, &a[j-8], 8);
+        if (b)
+            memcpy(&wb, &b[j-8], 8);
+        else
+            wb = fill;
+        if (wa != wb)
+            break;
+    }
+#endif
+    while (--j >= 0)
+        if (a[j] != BACK(b, c, j))
+            break;
+    return j;
+}
+
+/* Pixels a rectangle costs beyond its area: descriptor, control extension
+ * and the restart of the LZW code table. */
+#define RECT_COST 256
+
+static long
+area(Rect r)
+{
+    return (long) r.w * r.h;
+}
+
+static Rect
+merge(Rect a, Rect b)
+{
+    Rect m;
+    m.x = a.x < b.x ? a.x : b.x;
+    m.y = a.y < b.y ? a.y : b.y;
+    m.w = (a.x+a.w > b.x+b.w ? a.x+a.w : b.x+b.w) - m.x;
+    m.h = (a.y+a.h > b.y+b.h ? a.y+a.h : b.y+b.h) - m.y;
+    return m;
+}
+
+/* Find the rectangles covering every pixel that changed, at most
+ * gif->max_rects of them, top to bottom. Each run of changed rows makes a
+ * band; a band is merged into the one above when that costs fewer pixels
+ * than a rectangle of its own, and the cheapest neighbours are merged
+ * while there are too many. Return the number of rectangles. */
+static int
+get_rects(ge_GIF *gif, Rect *rects)
+{
+    int i, k, n, best, left, right;
+    int max = gif->max_rects < 1 ? 1 : gif->max_rects > GE_MAX_RECTS ? GE_MAX_RECTS : gif->max_rects;
+    long cost, best_cost;
+    uint8_t c = (uint8_t) gif->bgindex;
+    const uint8_t *a, *b;
+    Rect row;
+    n = 0;
     for (i = 0; i < gif->h; i++) {
-        for (j = 0; j < gif->w; j++, k++) {
-            back = gif->bgindex >= 0 ? gif->bgindex : gif->back[k];
-            if (gif->frame[k] != back) {
-                if (j < left)   left    = j;
-                if (j > right)  right   = j;
-                if (i < top)    top     = i;
-                if (i > bottom) bottom  = i;
+        a = &gif->frame[i*gif->w];
+        b = gif->bgindex >= 0 ? NULL : &gif->back[i*gif->w];
+        left = first_diff(a, b, c, gif->w);
+        if (left == gif->w)
+            continue;
+        right = last_diff(a, b, c, gif->w);
+        row.x = left; row.y = i; row.w = right - left + 1; row.h = 1;
+        if (n && rects[n-1].y + rects[n-1].h == i) {
+            rects[n-1] = merge(rects[n-1], row);
+            continue;
+        }
+        if (n && area(merge(rects[n-1], row)) - area(rects[n-1]) - area(row) < RECT_COST) {
+            rects[n-1] = merge(rects[n-1], row);
+            continue;
+        }
+        rects[n++] = row;
+        if (n > max) {
+            best = 0;
+            best_cost = -1;
+            for (k = 0; k + 1 < n; k++) {
+                cost = area(merge(rects[k], rects[k+1])) - area(rects[k]) - area(rects[k+1]);
+                if (best_cost < 0 || cost < best_cost) {
+                    best = k;
+                    best_cost = cost;
+                }
             }
+            rects[best] = merge(rects[best], rects[best+1]);
+            for (k = best + 1; k + 1 < n; k++)
+                rects[k] = rects[k+1];
+            n--;
         }
     }
-    if (left != gif->w && top != gif->h) {
-        *x = left; *y = top;
-        *w = right - left + 1;
-        *h = bottom - top + 1;
-        return 1;
-    } else {
-        return 0;
-    }
+    return n;
 }
 
 static void
-add_graphics_control_extension(ge_GIF *gif, uint16_t d)
+add_graphics_control_extension(ge_GIF *gif, uint16_t d, int delta)
 {
     uint8_t flags = ((gif->bgindex >= 0 ? 2 : 1) << 2) + 1;
-    write(gif->fd, (uint8_t []) {'!', 0xF9, 0x04, flags}, 4);
-    write_num(gif->fd, d);
-    write(gif->fd, (uint8_t []) {(uint8_t) gif->bgindex, 0x00}, 2);
+    uint8_t index = delta ? (uint8_t) gif->transparent : (uint8_t) gif->bgindex;
+    sink_write(gif->sink, (uint8_t []) {'!', 0xF9, 0x04, flags}, 4);
+    write_num(gif->sink, d);
+    sink_write(gif->sink, (uint8_t []) {index, 0x00}, 2);
 }
 
 void
 ge_add_frame(ge_GIF *gif, uint16_t delay)
 {
-    uint16_t w, h, x, y;
+    Rect rects[GE_MAX_RECTS + 1];
+    int n, r, delta;
+    uint16_t d;
     uint8_t *tmp;
+    double start, emitted;
 
-    if (delay || (gif->bgindex >= 0))
-        add_graphics_control_extension(gif, delay);
+    start = now();
+    delta = gif->transparent >= 0 && gif->bgindex < 0 && gif->nframes > 0;
     if (gif->nframes == 0) {
-        w = gif->w;
-        h = gif->h;
-        x = y = 0;
-    } else if (!get_bbox(gif, &w, &h, &x, &y)) {
+        rects[0] = (Rect) {0, 0, gif->w, gif->h};
+        n = 1;
+    } else if (!(n = get_rects(gif, rects))) {
         /* image's not changed; save one pixel just to add delay */
-        w = h = 1;
-        x = y = 0;
+        rects[0] = (Rect) {0, 0, 1, 1};
+        n = 1;
+    }
+    gif->rects_time += now() - start;
+    start = now();
+    emitted = gif->sink->emit_time;
+    for (r = 0; r < n; r++) {
+        /* the frame's delay comes after its last rectangle */
+        d = r == n - 1 ? delay : 0;
+        if (d || (gif->bgindex >= 0) || delta)
+            add_graphics_control_extension(gif, d, delta);
+        put_image(gif, rects[r].w, rects[r].h, rects[r].x, rects[r].y, delta);
+    }
+    gif->lzw_time += now() - start - (gif->sink->emit_time - emitted);
+    gif->nframes++;
+    if (gif->sink->flush == GE_FLUSH_FRAME)
+        ge_sink_flush(gif->sink);
+    if (gif->bgindex < 0) {
+        tmp = gif->back;
+        gif->back = gif->frame;
+        gif->frame = tmp;
     }
-    put_image(gif, w, h, x, y);
+}
+
+/* Take the frame as already shown without writing it, so the next frame
+ * is encoded against it, as if it followed it in the same file. */
+void
+ge_skip_frame(ge_GIF *gif)
+{
+    uint8_t *tmp;
     gif->nframes++;
     if (gif->bgindex < 0) {
         tmp = gif->back;
@@ -314,10 +701,36 @@ ge_add_frame(ge_GIF *gif, uint16_t delay)
     }
 }
 
+/* Text of up to 255 bytes per sub-block, ignored by decoders. */
+void
+ge_add_comment(ge_GIF *gif, const char *text)
+{
+    size_t n, len = strlen(text);
+    sink_write(gif->sink, (uint8_t []) {'!', 0xFE}, 2);
+    while (len) {
+        n = len < 0xFF ? len : 0xFF;
+        sink_write(gif->sink, (uint8_t []) {(uint8_t) n}, 1);
+        sink_write(gif->sink, text, n);
+        text += n;
+        len -= n;
+    }
+    sink_write(gif->sink, "\0", 1);
+}
+
+/* Flush the sink and free the encoder, without a trailer. */
+void
+ge_close_fragment(ge_GIF *gif)
+{
+    ge_sink_flush(gif->sink);
+    free(gif);
+}
+
+/* Write the trailer and flush the sink. The sink stays open, so its owner
+ * can still read a memory sink's output before calling ge_sink_close. */
 void
 ge_close_gif(ge_GIF* gif)
 {
-    write(gif->fd, ";", 1);
-    close(gif->fd);
+    sink_write(gif->sink, ";", 1);
+    ge_sink_flush(gif->sink);
     free(gif);
 }
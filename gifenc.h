@@ -1,31 +1,100 @@
 #ifndef GIFENC_H
 #define GIFENC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Where the encoded bytes go. Output is gathered in a userspace buffer
+ * and handed on in large writes. */
+enum { GE_SINK_FD, GE_SINK_MEMORY, GE_SINK_CALLBACK };
+/* Flush policies: only when the buffer fills up (and on close), or also
+ * after every frame, so a reader on a pipe sees whole frames promptly. */
+enum { GE_FLUSH_FULL, GE_FLUSH_FRAME };
+
+#define GE_MAX_RECTS 16
+
+typedef int (*ge_WriteFn)(void *ctx, const uint8_t *data, size_t n);
+
+typedef struct ge_Sink {
+    int type;
+    int flush;
+    int error;
+    /* GE_SINK_FD */
+    int fd, own_fd;
+    /* GE_SINK_MEMORY: the output so far, grown as needed */
+    uint8_t *mem;
+    size_t size, cap;
+    /* GE_SINK_CALLBACK: returns 0 on success */
+    ge_WriteFn write;
+    void *ctx;
+    /* position of the next byte in the output, buffered or not: the bytes
+     * handed to the sink so far, after the offset it resumed from */
+    long long offset;
+    /* seconds spent handing bytes on to the destination */
+    double emit_time;
+    uint8_t *buf;
+    size_t len, bufsize;
+} ge_Sink;
+
+ge_Sink *ge_sink_file(const char *fname);
+ge_Sink *ge_sink_resume(const char *fname, long long offset);
+ge_Sink *ge_sink_fd(int fd);
+ge_Sink *ge_sink_memory(void);
+ge_Sink *ge_sink_callback(ge_WriteFn write, void *ctx);
+void ge_sink_write(ge_Sink *sink, const void *data, size_t n);
+int ge_sink_flush(ge_Sink *sink);
+int ge_sink_close(ge_Sink *sink);
+
 typedef struct ge_GIF {
     uint16_t w, h;
     int depth;
     int bgindex;
-    int fd;
+    ge_Sink *sink;
     int offset;
     int nframes;
     uint8_t *frame, *back;
     uint32_t partial;
     uint8_t buffer[0xFF];
+    /* LZW dictionary, reused across code table resets and frames */
+    uint32_t lzw_stamp;
+    uint64_t *lzw;
+    /* Delta frames (needs bgindex < 0): when transparent >= 0, pixels that
+     * did not change since the last frame are written as that index, which
+     * must be below 1 << depth and unused by the image. */
+    int transparent;
+    /* Most rectangles a frame's changes may be split into, 1 to
+     * GE_MAX_RECTS. Every rectangle but the last gets a delay of 0, which
+     * some viewers stretch, so 1 is the safe choice for animations. */
+    int max_rects;
+    /* Seconds ge_add_frame spent finding the changed rectangles and
+     * LZW-compressing them (not counting the sink's emit_time), over every
+     * frame so far. */
+    double rects_time, lzw_time;
 } ge_GIF;
 
 ge_GIF *ge_new_gif(
-    const char *fname, uint16_t width, uint16_t height,
+    ge_Sink *sink, uint16_t width, uint16_t height,
     uint8_t *palette, int depth, int bgindex, int loop
 );
 void ge_add_frame(ge_GIF *gif, uint16_t delay);
 void ge_close_gif(ge_GIF* gif);
 
+/* Fragments hold frames only, with no header, palette or trailer, so that
+ * several encoders can each write part of one animation. Their bytes are
+ * joined with ge_sink_write behind a ge_new_gif of the same size and depth.
+ * ge_skip_frame takes the frame before a fragment's first as shown without
+ * writing it, so delta frames carry on across the join. */
+ge_GIF *ge_new_fragment(
+    ge_Sink *sink, uint16_t width, uint16_t height, int depth, int bgindex
+);
+void ge_skip_frame(ge_GIF *gif);
+void ge_add_comment(ge_GIF *gif, const char *text);
+void ge_close_fragment(ge_GIF *gif);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,15 +10,25 @@
 //frames from "stuttering"
 #define FRAMERATE 90
 /*
-    The number of colours that show up on screen. The recommended is 5, 6, or 7.
-    In general, the more you want to zoom in, the higher it should be.
-    1 <= Palette_depth <= 7
+    The number of colours that show up on screen is 2^PALETTE_DEPTH. The recommended is 5, 6, or 7.
+    Escape counts past the last colour wrap around the palette, see palette_lut.
+    2 <= Palette_depth <= 7
 */
 #define PALETTE_DEPTH 7
 
+//The number of colours in the palette. Colour 0 is the set itself
+#define PALETTE_SIZE (1 << PALETTE_DEPTH)
+
+//The number of iterations every pixel is given before it is considered to be in the set
+#define BASE_ITERATIONS 128
+
+//The most iterations a pixel is ever given. Tiles on the boundary of the set are given more than BASE_ITERATIONS, up to this
+#define MAX_ITERATIONS 4096
+
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 //Struct for pixel information
 typedef struct Pixel
@@ -34,27 +44,18 @@ typedef struct Coord
     long double imag;
 } Coord;
 
-// ------ Linked List -------- //
-
-//Index starts at one
-typedef struct panel_ll
-{
-    Coord max;
-    Coord mid;
-    int duration;
-    struct panel_ll* next;
-} Panel_Node;
-
-//RETURN a new panel with a NULL next pointer
-Panel_Node* newPanel(Coord max, Coord mid, int duration);
+// ------ Palette -------- //
 
-//RETURN the root of a linked list with a panelnode added at index. index Assumes index is valid.
-Panel_Node* addPanel(Panel_Node* root, Panel_Node* new, int index);
+/*
+    FILLS lut with the palette colour of every escape count from 0 to MAX_ITERATIONS. Points in the set (0) are
+    colour 0, counts below PALETTE_SIZE are their own colour and higher ones cycle through colours 1 and up,
+    so escaped points are never coloured as the set however many iterations they took
 
-//RETURN the root of a linked list with a panelnode deleted at index index. Assumes index is valid.
-Panel_Node* deletePanel(Panel_Node* root, int index);
+    \param lut MAX_ITERATIONS + 1 entries long
+*/
+void palette_lut(uint8_t* lut);
 
-//PRINT the information in the linked list pointed to by root
-void printInfo(Panel_Node* root);
+//FILLS rgb with the red, green and blue of each of the PALETTE_SIZE colours, as shown on screen and written to gifs and posters
+void palette_rgb(uint8_t* rgb);
 
 #endif // #ifndef _HELPER
\ No newline at end of file
@@ -9,8 +9,16 @@ Tian Yu
 */
 
 #include <SDL2/SDL.h>
+#include <string.h>
 #include "helper.h"
 #include "gifenc.h"
+#include "escape.h"
+#include "frame.h"
+#include "timeline.h"
+#include "cache.h"
+#include "export.h"
+#include "poster.h"
+#include "batch.h"
 
 //----------------------------------//
 
@@ -19,13 +27,19 @@ typedef struct Backend
 {
     SDL_Window* p_window;
     SDL_Renderer* p_renderer;
+
+    //The screen is drawn into pixels (ARGB, row major) and uploaded to p_texture once per frame
+    SDL_Texture* p_texture;
+    Uint32* pixels;
+
+    //The escape counts of the view on screen, kept so a pan only renders what it uncovers and a snapshot
+    //need not render them again for the gif. Not complete while they hold blocks of a dropped progressive render
+    Iter_Buffer* counts;
 } Backend;
 
 /*
-    INITIALISES p_window and p_renderer and sets them up
-
-    \param p_window The pointer to where the window will be stored
-    \param p_renderer The pointer to where the renderer will be stored
+    INITIALISES the window, renderer and screen texture and sets them up. Falls back to
+    the software renderer when there is no accelerated one, eg under SDL_VIDEODRIVER=dummy
 */
 Backend init_backend()
 {
@@ -37,21 +51,51 @@ Backend init_backend()
 
     backend.p_renderer = SDL_CreateRenderer(backend.p_window, -1, SDL_RENDERER_ACCELERATED);
 
+    if(backend.p_renderer == NULL)
+    {
+        backend.p_renderer = SDL_CreateRenderer(backend.p_window, -1, SDL_RENDERER_SOFTWARE);
+    }
+
+    backend.p_texture = SDL_CreateTexture(backend.p_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+
+    backend.pixels = (Uint32*) calloc(WIDTH * HEIGHT, sizeof(Uint32));
+    backend.counts = newIterBuffer(WIDTH, HEIGHT);
+
     return backend;
 }
 
 
 /*
-    FREES p_window and p_renderer
+    FREES the window, renderer, texture and screen buffers
 
-    \param p_window The pointer to where the window will be stored
-    \param p_renderer The pointer to where the renderer will be stored
+    \param p_backend The backend being freed
 */
-void del_backend(SDL_Window* p_window, SDL_Renderer* p_renderer)
+void del_backend(Backend* p_backend)
 {
-    SDL_RenderClear(p_renderer);
-    SDL_DestroyWindow(p_window);
+    SDL_RenderClear(p_backend->p_renderer);
+    SDL_DestroyTexture(p_backend->p_texture);
+    SDL_DestroyRenderer(p_backend->p_renderer);
+    SDL_DestroyWindow(p_backend->p_window);
     SDL_Quit();
+    free(p_backend->pixels);
+    deleteIterBuffer(p_backend->counts);
+}
+
+/*
+    UPLOADS the part of the screen buffer inside dirty to the texture and presents the whole texture
+
+    \param p_backend The backend being presented
+    \param dirty The region of the screen buffer which changed since the last upload. Skipped if it is empty
+*/
+void present(Backend* p_backend, SDL_Rect dirty)
+{
+    if(dirty.w > 0 && dirty.h > 0)
+    {
+        SDL_UpdateTexture(p_backend->p_texture, &dirty, p_backend->pixels + dirty.y * WIDTH + dirty.x, WIDTH * sizeof(Uint32));
+    }
+
+    SDL_RenderCopy(p_backend->p_renderer, p_backend->p_texture, NULL, NULL);
+    SDL_RenderPresent(p_backend->p_renderer);
 }
 
 //----------------------------------//
@@ -64,217 +108,223 @@ void print_options()
     "1) View current cordinates\n"
     "2) Go to coordinates\n"
     "3) Pan with mouse\n"
+    "9) Switch between brute force, subdivision and progressive rendering\n"
+    "10) Save a poster of the current view\n"
     "\n======= GIF CREATION OPTIONS =======\n"
     "4) Check snapshot\n"
     "5) Add current frame as snapshot\n"
     "6) Delete snapshot\n"
     "7) Save gif\n"
-    "8) Display options\n");
+    "8) Display options\n"
+    "11) Save snapshots to a timeline file\n"
+    "12) Load snapshots from a timeline file\n");
 }
 
-//----------------------------------//
+//Prints what the tile cache did over the session
+void print_cache(Cache* p_cache)
+{
+    Cache_Stats stats = cache_stats(p_cache);
+    printf("Tile cache: %ld hits, %ld misses, %ld evictions, %ld tiles in %.1f MB\n",
+           stats.hits, stats.misses, stats.evictions, stats.tiles, stats.bytes / 1048576.0);
+}
 
-//Functions for testing if a point is in the mandelbrot set
+//----------------------------------//
 
 /*
-    RETURNS the number of iterations it takes for query to escape. Return 0 if query does not escape (arbitrary decision to make colouring easier)
+    COLOURS the escape counts of the backend into its screen buffer and presents them
 
-    \param query - the coordinate in question
+    \param p_backend The backend whose escape counts are shown
+    \param precision The precision the escape counts were iterated in, logged when it changes
 */
-int escape(Coord query)
+void draw(Backend* p_backend, Precision precision)
 {
+    //Only changes of precision are logged, so panning does not flood the terminal
+    static int last_precision = -1;
 
-    Coord init;
+    //The screen colour of every escape count, through the same palette as the gif
+    static Uint32 colours[MAX_ITERATIONS + 1];
 
-    init.real = query.real;
-    init.imag = query.imag;
-
-    for(float i = 1; i <= pow(2, PALETTE_DEPTH); i++) 
+    if(colours[0] == 0)
     {
-        if(query.real > 2 || query.imag > 2)
+        uint8_t lut[MAX_ITERATIONS + 1], rgb[PALETTE_SIZE * 3];
+        palette_lut(lut);
+        palette_rgb(rgb);
+
+        for(int count = 0; count <= MAX_ITERATIONS; count++)
         {
-            return i;
+            const uint8_t* colour = rgb + 3 * lut[count];
+            colours[count] = 0xFF000000 | ((Uint32) colour[0] << 16) | ((Uint32) colour[1] << 8) | colour[2];
         }
-        float temp = query.real;
-
-        query.real = pow(query.real, 2) - pow(query.imag, 2) + init.real;
-        query.imag = 2 * temp * query.imag + init.imag;
     }
 
-    return 0;
-
-}
-
-/*
-    RENDERS the mandelbrot set
-    Warning: max.real:max.imag :: WIDTH:HEIGHT, otherwise the fractal will be stretched/compressed
-
-    \param p_renderer The renderer on which the function renders
-    \param max The largest coordinate on the screen
-    \param mid The coordinate at the centre of the screen
-*/
-void render(SDL_Renderer* p_renderer, Coord max, Coord mid)
-{
-    //Each pixel is scale units apart (cartesian units/pixel)
-    Coord scale;
-    scale.real = 2 * max.real / WIDTH;
-    scale.imag = 2 * max.imag / HEIGHT;
+    if((int) precision != last_precision)
+    {
+        printf("Iterating in %s precision\n", precision_name(precision));
+        last_precision = precision;
+    }
 
-    //The cartesian point being rendered
-    Coord point;
+    //Bounds of the pixels whose colour changed, only those are uploaded
+    int left = WIDTH, right = -1, top = HEIGHT, bottom = -1;
 
-    for(int pixel_x = 0; pixel_x < WIDTH; pixel_x++)
+    for(int pixel_y = 0; pixel_y < HEIGHT; pixel_y++)
     {
-        point.real = pixel_x * scale.real - max.real + mid.real;
-        
-        for(int pixel_y = 0; pixel_y < HEIGHT; pixel_y++)
+        Uint32* row = p_backend->pixels + pixel_y * WIDTH;
+
+        for(int pixel_x = 0; pixel_x < WIDTH; pixel_x++)
         {
-            point.imag = pixel_y * scale.imag - max.imag + mid.imag;
-            Uint8 triple = (Uint8) (255 * ( (double) (escape(point))/pow(2, PALETTE_DEPTH)) );
+            Uint32 colour = colours[p_backend->counts->iters[pixel_y * WIDTH + pixel_x]];
 
-            SDL_SetRenderDrawColor(p_renderer, triple, 0, 0, 0xFF);
-            SDL_RenderDrawPoint(p_renderer, pixel_x, pixel_y);
-            
+            if(row[pixel_x] != colour)
+            {
+                row[pixel_x] = colour;
+                if(pixel_x < left) left = pixel_x;
+                if(pixel_x > right) right = pixel_x;
+                if(pixel_y < top) top = pixel_y;
+                bottom = pixel_y;
+            }
         }
 
     }
 
-    SDL_RenderPresent(p_renderer);
+    SDL_Rect dirty = {.x = left, .y = top, .w = right - left + 1, .h = bottom - top + 1};
+    present(p_backend, dirty);
+
+}
+
+//Rows are rendered this many at a time in progressive passes, checking for new events in between
+#define PROGRESSIVE_BAND (2 * TILE_SIZE)
 
+//RETURN whether an event that moves the view is waiting, without taking it off the queue
+int view_event_pending()
+{
+    SDL_PumpEvents();
+
+    if(SDL_HasEvent(SDL_QUIT) || SDL_HasEvent(SDL_KEYDOWN) || SDL_HasEvent(SDL_MOUSEBUTTONDOWN) || SDL_HasEvent(SDL_MOUSEBUTTONUP)) return 1;
+
+    //Moving the mouse only moves the view while a button is held
+    return SDL_HasEvent(SDL_MOUSEMOTION) && (SDL_GetMouseState(NULL, NULL) & SDL_BUTTON_LMASK);
 }
 
 /*
-    ADD the frame specified to the gif
-    Warning: max.real:max.imag :: WIDTH:HEIGHT, otherwise the fractal will be stretched/compressed
+    RENDERS the mandelbrot set in coarse-to-fine passes, showing each one as soon as it is done.
+    Passes still to come are dropped as soon as an event that moves the view arrives.
 
-    \param gif The gif the frame is added to
+    \param p_backend The backend on which the function renders
+    \param p_pool The thread pool the escape counts are computed on
     \param max The largest coordinate on the screen
     \param mid The coordinate at the centre of the screen
-    \param sidelength The sidelength of the gif
-    \param mili_duration The duration of the frame in miliseconds
 */
-void gif_render(ge_GIF* gif, Coord max, Coord mid, int sidelength, int mili_duration)
+void render_progressive(Backend* p_backend, Pool* p_pool, Coord max, Coord mid)
 {
-    //Each pixel is scale units apart (cartesian units/pixel)
-    Coord scale;
-    scale.real = 2 * max.real / sidelength;
-    scale.imag = 2 * max.imag / sidelength;
-
-    //The cartesian point being rendered
-    Coord point;
+    Iter_Buffer* counts = p_backend->counts;
+    counts->complete = 0;
 
-    for(int pixel_x = 0; pixel_x < sidelength; pixel_x++)
+    for(int step = PROGRESSIVE_STEP; step >= 1; step /= 2)
     {
-        point.real = pixel_x * scale.real - max.real + mid.real;
-        
-        for(int pixel_y = 0; pixel_y < sidelength; pixel_y++)
-        {
-            point.imag = pixel_y * scale.imag - max.imag + mid.imag;
+        Precision precision = PRECISION_FLOAT;
 
-            gif->frame[(pixel_y * sidelength) + pixel_x] = escape(point);
+        //The last pass renders whole tiles, so its bands start where rows of tiles do
+        int first = step == 1 ? tile_row(WIDTH, HEIGHT, max, mid) : 0;
+
+        for(int band = first > 0 ? first - PROGRESSIVE_BAND : 0; band < HEIGHT; band += PROGRESSIVE_BAND)
+        {
+            //The first pass is always shown, so there is something on screen however deep the view is
+            if(step < PROGRESSIVE_STEP && view_event_pending()) return;
 
+            int top = band > 0 ? band : 0;
+            int bottom = HEIGHT - band < PROGRESSIVE_BAND ? HEIGHT : band + PROGRESSIVE_BAND;
+            precision = render_pass(p_pool, counts->iters, WIDTH, HEIGHT, max, mid, step, 0, top, WIDTH, bottom - top);
         }
 
+        draw(p_backend, precision);
+        counts->precision = precision;
     }
 
-    ge_add_frame(gif, mili_duration);
-
+    counts->max = max;
+    counts->mid = mid;
+    counts->mode = RENDER_PROGRESSIVE;
+    counts->complete = 1;
 }
 
-
-
 /*
-    Renders the gif specified by the snapshots in root
+    RENDERS the mandelbrot set
+    Warning: max.real:max.imag :: WIDTH:HEIGHT, otherwise the fractal will be stretched/compressed
 
-    \param filename The filename of the gif
-    \param sidelength The sidelength of the gif
-    \param root The linked list of snapshots to be rendered
-*/void save_gif(char* filename, int sidelength, Panel_Node* root)
+    \param p_backend The backend on which the function renders
+    \param p_pool The thread pool the escape counts are computed on
+    \param p_cache The cache of tiles rendered before, shared by every view
+    \param max The largest coordinate on the screen
+    \param mid The coordinate at the centre of the screen
+    \param mode How the pixels are found, see frame.h
+*/
+void render(Backend* p_backend, Pool* p_pool, Cache* p_cache, Coord max, Coord mid, Render_Mode mode)
 {
-    if(root == NULL)
+    if(mode == RENDER_PROGRESSIVE)
     {
-        printf("No snapshots in the current gif. Returning to main menu\n");
+        render_progressive(p_backend, p_pool, max, mid);
         return;
     }
 
-    uint8_t palette[(int) pow(2, PALETTE_DEPTH) * 3];
-
-    for(int i = 0; i < pow(2, PALETTE_DEPTH); i++)
-    {
-        palette[3 * i] = i * 255 / (pow(2, PALETTE_DEPTH) - 1);
-        palette[3 * i + 1] = 0;
-        palette[3 * i + 2] = 0;
-    }
-    
-    ge_GIF *gif = ge_new_gif(
-        filename,
-        sidelength, sidelength,
-        palette,
-        PALETTE_DEPTH,
-        -1,
-        0
-    );
-
-    Panel_Node* next_panel = root->next;
+    draw(p_backend, render_buffer(p_pool, p_cache, p_backend->counts, max, mid, mode));
+}
 
-    int snapshot_index = 0;
-    int mili_duration = 1;
+/*
+    ZOOMS from the view on screen to a new one with the same centre. The old counts are resampled and shown
+    at once as a preview, then only the pixels which do not land exactly on an old one are iterated.
+    Every mode finishes the view as brute force would
+
+    \param p_backend The backend on which the function renders
+    \param p_pool The thread pool the escape counts are computed on
+    \param p_cache The cache of tiles rendered before, shared by every view
+    \param from_max The largest coordinate of the view on screen
+    \param from_mid The coordinate at the centre of the view on screen
+    \param max The largest coordinate of the new view
+    \param mid The coordinate at the centre of the new view
+    \param mode How the pixels are found when nothing can be reused, see frame.h
+*/
+void zoom(Backend* p_backend, Pool* p_pool, Cache* p_cache, Coord from_max, Coord from_mid, Coord max, Coord mid, Render_Mode mode)
+{
+    Iter_Buffer* counts = p_backend->counts;
 
-    while(next_panel != NULL)
+    //Blocks left by a dropped progressive render are not true counts of any pixel
+    if(!counts->complete)
     {
+        render(p_backend, p_pool, p_cache, max, mid, mode);
+        return;
+    }
 
-        Coord frame_max = {.real = root->max.real, .imag = root->max.imag};
-        Coord frame_mid = {.real = root->mid.real, .imag = root->mid.imag};
-
-        int numframes = FRAMERATE * root->duration;
-
-        //Calculating the change in mid and max with every frame
-        Coord delta_mid = {.real = (next_panel->mid.real - root->mid.real) / numframes, .imag = (next_panel->mid.imag - root->mid.imag) / numframes};
-        Coord ddelta_max = {.real = ((next_panel->max.real - next_panel->mid.real) - (root->max.real - root->mid.real)) / numframes,
-                        .imag = ((next_panel->max.imag - next_panel->mid.imag) - (root->max.imag - root->mid.imag)) / numframes};
-
-
-        mili_duration = (int) ((1.0 / FRAMERATE) * 1000);
-
-
-        for(int i = 0; i <= FRAMERATE * root->duration; i++)
-        {
-            gif_render(gif, frame_max, frame_mid, sidelength, mili_duration);
-            //Debugging
-            //printf("Snapshot %d, Frame %d/%d at (%Lf, %Lf) with max (%Lf, %Lf) and duration %d\n", snapshot_index + 1, i, FRAMERATE * root->duration, frame_mid.real, frame_mid.imag, frame_max.real, frame_max.imag, mili_duration);
-
-            frame_max.real += ddelta_max.real + delta_mid.real;
-            frame_max.imag += ddelta_max.imag + delta_mid.imag;
-
-            frame_mid.real += delta_mid.real;
-            frame_mid.imag += delta_mid.imag;
+    uint16_t* from = (uint16_t*) malloc(WIDTH * HEIGHT * sizeof(uint16_t));
+    uint8_t* known = (uint8_t*) malloc(WIDTH * HEIGHT);
+    memcpy(from, counts->iters, WIDTH * HEIGHT * sizeof(uint16_t));
 
-        }
+    resample_frame(from, counts->iters, known, WIDTH, HEIGHT, from_max, from_mid, max, mid);
+    draw(p_backend, frame_precision(WIDTH, HEIGHT, max, mid));
 
-        snapshot_index++;
+    counts->precision = refine_frame(p_pool, counts->iters, known, WIDTH, HEIGHT, max, mid);
+    counts->max = max;
+    counts->mid = mid;
+    counts->mode = RENDER_BRUTE_FORCE;
+    draw(p_backend, counts->precision);
 
-        root = next_panel;
-        next_panel = root->next;
-
-    }
-    gif_render(gif, root->max, root->mid, sidelength, mili_duration);
-
-    ge_close_gif(gif);
-    printf("%s created\n", filename);
+    free(from);
+    free(known);
 }
 
-
 /*
     PANS the current camera when the left mouse button is pressed. The function
     pans the current X and Y coordinates of the screen at a one to one ratio to 
     the distance the mouse moves. The function exits when the mouse button is
     released.
 
+    \param p_backend The backend on which the function renders
+    \param p_pool The thread pool the escape counts are computed on
+    \param p_cache The cache of tiles rendered before, shared by every view
     \param init The mouse's pixel coordinates at the time the mouse is pressed
     \param max The magnitude of the area being rendered
     \param p_mid The pointer to the current midpoint
+    \param mode How the pixels are found, see frame.h
 */
-void pan(SDL_Renderer* p_renderer, Pixel init, Coord max, Coord* p_mid)
+void pan(Backend* p_backend, Pool* p_pool, Cache* p_cache, Pixel init, Coord max, Coord* p_mid, Render_Mode mode)
 {
     SDL_Event e;
 
@@ -284,6 +334,10 @@ void pan(SDL_Renderer* p_renderer, Pixel init, Coord max, Coord* p_mid)
 
     Uint32 time_init = SDL_GetTicks();
 
+    //mid only ever moves by whole pixels from where the pan started, so the counts kept on screen stay exact
+    Coord origin = *p_mid;
+    Pixel moved = {0, 0};
+
     while(!quit)
     {
         while(SDL_PollEvent(&e) != 0)
@@ -295,25 +349,43 @@ void pan(SDL_Renderer* p_renderer, Pixel init, Coord max, Coord* p_mid)
             {
                 time_init = e.motion.timestamp;
 
-                p_mid->real = p_mid->real - ((e.motion.x - init.x) * ((2 * max.real)/WIDTH));
-                p_mid->imag = p_mid->imag + ((init.y - e.motion.y) * ((2 * max.imag)/HEIGHT));
+                int dx = e.motion.x - init.x;
+                int dy = e.motion.y - init.y;
+                moved.x += dx;
+                moved.y += dy;
+
+                p_mid->real = origin.real - moved.x * ((2 * max.real)/WIDTH);
+                p_mid->imag = origin.imag - moved.y * ((2 * max.imag)/HEIGHT);
     
                 init.x = e.motion.x;
                 init.y = e.motion.y;
 
-                render(p_renderer, max, *(p_mid));
+                //Blocks left by a dropped progressive render would be dragged along, so they are started over
+                Iter_Buffer* counts = p_backend->counts;
+
+                if(counts->complete)
+                {
+                    counts->precision = pan_frame(p_pool, p_cache, counts->iters, WIDTH, HEIGHT, max, counts->mid, *(p_mid), mode, dx, dy);
+                    counts->mid = *(p_mid);
+                    draw(p_backend, counts->precision);
+                }
+                else render(p_backend, p_pool, p_cache, max, *(p_mid), mode);
                 
             }
             
         }
 
     }
-}
 
+    //Finishes what the last movement left coarse
+    if(!p_backend->counts->complete) render(p_backend, p_pool, p_cache, max, *(p_mid), mode);
+}
 
 
-int main()
+int main(int argc, char** argv)
 {
+    //Any arguments render a gif without opening a window, see batch.h
+    if(argc > 1) return run_batch(argv[0], argc - 1, argv + 1);
 
     //----------------------------------//
 
@@ -327,8 +399,7 @@ int main()
 
     //Variables for saving a gif, index starting at 1
 
-    Panel_Node* root = NULL;
-    int num_snapshots = 0;
+    Timeline* timeline = newTimeline();
     int panel_index = 1;
 
     char name[128];
@@ -345,18 +416,26 @@ int main()
     max.real = 3;
     max.imag = 3;
 
-    //----------------------------------//
+    //max is always base scaled by 0.75^zoom_level, so zooming back out lands on exactly the views (and cached tiles) zoomed through
+    Coord base = max;
+    int zoom_level = 0;
+
+    //Brute force or subdivision, toggled from the menu
+    Render_Mode mode = RENDER_BRUTE_FORCE;
 
-    //Initializing window and renderer
-    SDL_Window* p_window = NULL;
-    SDL_Renderer* p_renderer = NULL;
+    //----------------------------------//
 
+    //Initializing window, renderer and screen texture
     Backend backend = init_backend();
+    Backend* p_backend = &backend;
+
+    //Thread pool shared by the screen and the gif encoder, sized by FRACTAL_THREADS
+    Pool* p_pool = newPool(0);
 
-    p_window = backend.p_window;
-    p_renderer = backend.p_renderer;
+    //Tiles already rendered, shared by the screen and the gif encoder, capped by FRACTAL_CACHE_MB
+    Cache* p_cache = newCache(0);
 
-    render(p_renderer, max, mid);
+    render(p_backend, p_pool, p_cache, max, mid, mode);
 
     //------ Main Loop -------//
    
@@ -368,6 +447,7 @@ int main()
            "|_|    |_|  \\_\\/_/    \\_\\_____|  |_/_/    \\_\\______|_____(_|_|_)_|  |_|____/ \n");
     printf("\n=======================================================================================\n\n");
     printf("A lightweight Mandelbrot fractal viewer and gif saver.\n");
+    printf("Escape kernel: %s, %d threads\n", escape_isa(), pool_size(p_pool));
 
     print_options();
 
@@ -384,7 +464,11 @@ int main()
         {
             case -1: //quit
                 printf("Ending\n");
-                del_backend(p_window, p_renderer);
+                print_cache(p_cache);
+                deleteTimeline(timeline);
+                del_backend(p_backend);
+                deletePool(p_pool);
+                deleteCache(p_cache);
                 return 0;
 
             case 0: //invalid input
@@ -392,7 +476,7 @@ int main()
                 break;
 
             case 1: //print current information
-                printf("The current frame is centered on (%Lf, %Lf) and the top right of the frame is (%Lf, %Lf)\n", mid.real, mid.imag, max.real, max.imag);
+                printf("The current frame is centered on (%.21Lg, %.21Lg) and the top right of the frame is (%.21Lg, %.21Lg)\n", mid.real, mid.imag, max.real, max.imag);
                 break;
 
             case 2: //go to coordinates
@@ -400,21 +484,25 @@ int main()
                 printf("Please input a x coordinate for the middle\n");
                 scanf("%127s", input);
                 getchar();
-                mid.real = strtod(input, NULL);
+                mid.real = strtold(input, NULL);
                 printf("Please input a y coordinate for the middle\n");
                 scanf("%127s", input);
                 getchar();
-                mid.imag = strtod(input, NULL);
+                mid.imag = strtold(input, NULL);
                 printf("Please input the x coordinate for the top right corner of the screen\n");
                 scanf("%127s", input);
                 getchar();
-                max.real = strtod(input, NULL);
+                max.real = strtold(input, NULL);
                 printf("Please input the y coordinate for the top right corner of the screen\n");
                 scanf("%127s", input);
                 getchar();
-                max.imag = strtod(input, NULL);
+                max.imag = strtold(input, NULL);
 
-                render(p_renderer, max, mid);
+                base = max;
+                zoom_level = 0;
+                mid = snap_mid(WIDTH, HEIGHT, max, mid);
+
+                render(p_backend, p_pool, p_cache, max, mid, mode);
                 break;
 
             case 3: //pan
@@ -428,7 +516,11 @@ int main()
                         if(e.type == SDL_QUIT)
                         {
                             printf("ending\n");
-                            del_backend(p_window, p_renderer);
+                            print_cache(p_cache);
+                            deleteTimeline(timeline);
+                            del_backend(p_backend);
+                            deletePool(p_pool);
+                            deleteCache(p_cache);
                             return 0;
                         }
                         else if(e.type == SDL_MOUSEBUTTONDOWN) 
@@ -436,23 +528,20 @@ int main()
                             Pixel init;
                             init.x = e.button.x;
                             init.y = e.button.y;
-                            pan(p_renderer, init, max, &(mid));
+                            pan(p_backend, p_pool, p_cache, init, max, &(mid), mode);
                         }
 
                         else if(e.type == SDL_KEYDOWN)
                         {
-                            if(e.key.keysym.sym == SDLK_d)
+                            if(e.key.keysym.sym == SDLK_d || e.key.keysym.sym == SDLK_f)
                             {
-                                max.real *= 0.75;
-                                max.imag *= 0.75;
-                                render(p_renderer, max, mid);
-                            }
+                                Coord from_max = max, from_mid = mid;
 
-                            else if(e.key.keysym.sym == SDLK_f)
-                            {
-                                max.real *= 1.25;
-                                max.imag *= 1.25;
-                                render(p_renderer, max, mid);
+                                zoom_level += e.key.keysym.sym == SDLK_d ? 1 : -1;
+                                max.real = base.real * powl(0.75L, zoom_level);
+                                max.imag = base.imag * powl(0.75L, zoom_level);
+                                mid = snap_mid(WIDTH, HEIGHT, max, mid);
+                                zoom(p_backend, p_pool, p_cache, from_max, from_mid, max, mid, mode);
                             }
 
                             else if(e.key.keysym.sym == SDLK_q)
@@ -468,18 +557,22 @@ int main()
                 break;
 
             case 4: //check gif information
-                printInfo(root);
+                timeline_print(timeline);
                 break;
 
             case 5: //add snapshot (no error checking)
                 
-                if(num_snapshots == 0) printf("Adding your snapshot to index 1 since the gif is empty.\n");
+                if(timeline->npanels == 0)
+                {
+                    printf("Adding your snapshot to index 1 since the gif is empty.\n");
+                    panel_index = 1;
+                }
                 else
                 {
-                    printf("Please input the index (1-%d) of your new snapshot\n", num_snapshots + 1);
+                    printf("Please input the index (1-%d) of your new snapshot\n", timeline->npanels + 1);
                     scanf("%127s", input);
                     getchar();
-                    if(atoi(input) <= 0)
+                    if(atoi(input) <= 0 || atoi(input) > timeline->npanels + 1)
                     {
                         printf("Invalid input, returning to main menu\n");
                         break;
@@ -495,35 +588,33 @@ int main()
                     printf("Invalid input, returning to main menu\n");
                     break;
                 }
-                if(num_snapshots == 0) root = newPanel(max, mid, atoi(input));
 
-                else root = addPanel(root, newPanel(max, mid, atoi(input)), panel_index);
+                //The counts on screen are the snapshot's own frame of the gif
+                timeline_insert(timeline, panel_index - 1, max, mid, atoi(input), backend.counts->complete ? copyIterBuffer(backend.counts) : NULL);
 
                 printf("Panel added\n");
-                num_snapshots++;
                 break;
 
             case 6: //delete snapshot
 
-                if(num_snapshots == 0)
+                if(timeline->npanels == 0)
                 {
                     printf("There are currently no frames in your gif\n");
                     break;
                 }
 
-                printf("Please input the index (1-%d) of the snapshot you want to delete\n", num_snapshots);
+                printf("Please input the index (1-%d) of the snapshot you want to delete\n", timeline->npanels);
                 scanf("%127s", input);
                 getchar();
-                if(atoi(input) < 1 || atoi(input) > num_snapshots)
+                if(atoi(input) < 1 || atoi(input) > timeline->npanels)
                 {
                     printf("Invalid input, returning to main menu\n");
                     break;
                 }
 
-                root = deletePanel(root, atoi(input));
+                timeline_delete(timeline, atoi(input) - 1);
 
                 printf("Panel deleted\n");
-                num_snapshots--;
                 break;
 
             case 7: //save gif
@@ -540,17 +631,86 @@ int main()
                     printf("Invalid input, returning to main menu\n");
                     break;
                 }
+                if(atoi(input) > GIF_MAX_SIZE)
+                {
+                    printf("Gifs are at most %d pixels across, returning to main menu\n", GIF_MAX_SIZE);
+                    break;
+                }
 
                 printf("Creating %s. This may take a while.\n", name);
 
-                save_gif(name, atoi(input), root);
-
-                //add status bar
+                Gif_Options options = gif_default_options();
+                options.mode = mode;
+                options.cache = p_cache;
+                save_gif(name, atoi(input), timeline, p_pool, options);
                 break;
 
             case 8: //print options
                 print_options();
                 break;
+
+            case 9: //cycle render modes
+                mode = mode == RENDER_BRUTE_FORCE ? RENDER_SUBDIVIDE : mode == RENDER_SUBDIVIDE ? RENDER_PROGRESSIVE : RENDER_BRUTE_FORCE;
+                printf("Rendering by %s\n", render_mode_name(mode));
+                render(p_backend, p_pool, p_cache, max, mid, mode);
+                break;
+
+            case 10: //save poster
+            {
+                printf("Please input a name for the poster, ending in .ppm, .pgm or .raw\n");
+                scanf("%127s", name);
+                getchar();
+
+                printf("Please input a width for the poster\n");
+                scanf("%127s", input);
+                getchar();
+
+                int poster_width = atoi(input);
+                int poster_height = (int) (poster_width * max.imag / max.real + 0.5L);
+
+                if(poster_width <= 0 || poster_height <= 0)
+                {
+                    printf("Invalid input, returning to main menu\n");
+                    break;
+                }
+
+                char pyramid[128];
+                printf("Please input a name for a zoomable pyramid of the poster ending in .dzi, or - for none\n");
+                scanf("%127s", pyramid);
+                getchar();
+
+                printf("Creating %s at %dx%d. This may take a while.\n", name, poster_width, poster_height);
+
+                Poster_Options poster_options = poster_default_options();
+                poster_options.mode = mode;
+                poster_options.pyramid = strcmp(pyramid, "-") == 0 ? NULL : pyramid;
+                save_poster(name, poster_width, poster_height, max, mid, p_pool, poster_options);
+                break;
+            }
+
+            case 11: //save timeline
+                printf("Please input a name for the timeline file\n");
+                scanf("%127s", name);
+                getchar();
+
+                if(timeline_save(timeline, name) == 0) printf("%d snapshots saved to %s\n", timeline->npanels, name);
+                else printf("Could not write %s\n", name);
+                break;
+
+            case 12: //load timeline
+            {
+                printf("Please input the name of the timeline file. Its snapshots replace the current ones\n");
+                scanf("%127s", name);
+                getchar();
+
+                Timeline* loaded = timeline_load(name);
+                if(loaded == NULL) break;
+
+                deleteTimeline(timeline);
+                timeline = loaded;
+                printf("%d snapshots loaded from %s\n", timeline->npanels, name);
+                break;
+            }
         }
 
     }
@@ -0,0 +1,185 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//The unclaimed indices [head, tail) of one thread. The owner takes from the head, thieves from the tail
+typedef struct Pool_Queue
+{
+    pthread_mutex_t lock;
+    int head;
+    int tail;
+} __attribute__((aligned(64))) Pool_Queue;
+
+struct Pool
+{
+    int nthreads;
+    pthread_t* threads;
+    Pool_Queue* queues;
+
+    //Guards everything below
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+
+    int generation;
+    int running;
+    int quit;
+
+    Pool_Task task;
+    void* job;
+};
+
+typedef struct Pool_Worker
+{
+    Pool* pool;
+    int id;
+} Pool_Worker;
+
+//RETURN the next index from the head of queue, or -1 if it is empty
+static int take(Pool_Queue* queue)
+{
+    int index = -1;
+    pthread_mutex_lock(&queue->lock);
+    if(queue->head < queue->tail) index = queue->head++;
+    pthread_mutex_unlock(&queue->lock);
+    return index;
+}
+
+//RETURN the last index from the tail of queue, or -1 if it is empty
+static int steal(Pool_Queue* queue)
+{
+    int index = -1;
+    pthread_mutex_lock(&queue->lock);
+    if(queue->head < queue->tail) index = --queue->tail;
+    pthread_mutex_unlock(&queue->lock);
+    return index;
+}
+
+//RUNS the tasks of worker id's own queue, then steals from the others until every queue is empty
+static void drain(Pool* pool, int id)
+{
+    int index;
+
+    while((index = take(&pool->queues[id])) >= 0) pool->task(pool->job, index);
+
+    for(int i = 1; i < pool->nthreads; i++)
+    {
+        Pool_Queue* victim = &pool->queues[(id + i) % pool->nthreads];
+        while((index = steal(victim)) >= 0) pool->task(pool->job, index);
+    }
+}
+
+static void* work(void* arg)
+{
+    Pool_Worker* worker = arg;
+    Pool* pool = worker->pool;
+    int seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while(1)
+    {
+        while(pool->generation == seen && !pool->quit) pthread_cond_wait(&pool->start, &pool->lock);
+        if(pool->quit) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        drain(pool, worker->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->running == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(worker);
+    return NULL;
+}
+
+int pool_default_threads()
+{
+    char* env = getenv(THREADS_ENV);
+    if(env != NULL && atoi(env) > 0) return atoi(env);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int) cpus : 1;
+}
+
+Pool* newPool(int nthreads)
+{
+    if(nthreads <= 0) nthreads = pool_default_threads();
+
+    Pool* pool = (Pool*) calloc(1, sizeof(Pool));
+    pool->nthreads = nthreads;
+    pool->threads = (pthread_t*) malloc(nthreads * sizeof(pthread_t));
+    if(posix_memalign((void**) &pool->queues, 64, nthreads * sizeof(Pool_Queue)) != 0) abort();
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(int i = 0; i < nthreads; i++)
+    {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+        pool->queues[i].head = pool->queues[i].tail = 0;
+    }
+
+    //Thread 0 is whoever calls pool_run
+    for(int i = 1; i < nthreads; i++)
+    {
+        Pool_Worker* worker = (Pool_Worker*) malloc(sizeof(Pool_Worker));
+        worker->pool = pool;
+        worker->id = i;
+        pthread_create(&pool->threads[i], NULL, work, worker);
+    }
+
+    return pool;
+}
+
+int pool_size(Pool* pool)
+{
+    return pool->nthreads;
+}
+
+void pool_run(Pool* pool, int ntasks, Pool_Task task, void* job)
+{
+    pthread_mutex_lock(&pool->lock);
+
+    for(int i = 0; i < pool->nthreads; i++)
+    {
+        pool->queues[i].head = (int) ((long) ntasks * i / pool->nthreads);
+        pool->queues[i].tail = (int) ((long) ntasks * (i + 1) / pool->nthreads);
+    }
+
+    pool->task = task;
+    pool->job = job;
+    pool->running = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    drain(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->running > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void deletePool(Pool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int i = 1; i < pool->nthreads; i++) pthread_join(pool->threads[i], NULL);
+
+    for(int i = 0; i < pool->nthreads; i++) pthread_mutex_destroy(&pool->queues[i].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,38 @@
+#ifndef _POOL
+#define _POOL
+
+//A persistent pool of worker threads that share out numbered tasks
+
+//Environment variable which sets the number of threads
+#define THREADS_ENV "FRACTAL_THREADS"
+
+//Runs task number index of a job
+typedef void (*Pool_Task)(void* job, int index);
+
+typedef struct Pool Pool;
+
+//RETURN a pool of nthreads threads (including the caller of pool_run). nthreads <= 0 uses pool_default_threads()
+Pool* newPool(int nthreads);
+
+//RETURN the number of threads set by THREADS_ENV, or the number of online cpus if it is not set
+int pool_default_threads();
+
+//RETURN the number of threads in pool, counting the caller of pool_run
+int pool_size(Pool* pool);
+
+/*
+    RUNS task on every index from 0 to ntasks - 1 and returns when they are all done.
+    Each thread starts on its own contiguous share of the indices and steals from the
+    back of a busy thread's share once its own runs out.
+
+    \param pool The pool running the tasks
+    \param ntasks The number of tasks
+    \param task The function run on every index
+    \param job Passed to every call of task
+*/
+void pool_run(Pool* pool, int ntasks, Pool_Task task, void* job);
+
+//FREES the pool and joins its threads
+void deletePool(Pool* pool);
+
+#endif // #ifndef _POOL
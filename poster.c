@@ -0,0 +1,387 @@
+#include "poster.h"
+#include "gifenc.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+//The progress line is redrawn at most this often, in seconds
+#define PROGRESS_INTERVAL 0.25
+
+//The longest path of a tile of the pyramid
+#define PYRAMID_PATH 1024
+
+//How the poster is stored
+typedef enum Poster_Format
+{
+    POSTER_PPM, //The palette colours, 8 bits per channel
+    POSTER_PGM, //The palette as shades of grey
+    POSTER_RAW //The escape counts, 16 bits each
+} Poster_Format;
+
+//One level of the pyramid, filled a row at a time
+typedef struct Pyramid_Level
+{
+    int number; //The level's number in the Deep Zoom pyramid, the full resolution has the highest
+    int width;
+    int height;
+    int row; //The next row of the level to arrive
+
+    uint8_t* tiles; //The rows of the row of tiles being filled, POSTER_TILE rows of width
+    uint8_t* pair; //An even row waiting for the one below it, to be halved into the next level
+    uint8_t* half; //The two halved into a row of the next level
+} Pyramid_Level;
+
+//A Deep Zoom pyramid of palette colours, the full resolution first
+typedef struct Pyramid
+{
+    char files[PYRAMID_PATH]; //The directory the levels' directories go in
+    int nlevels;
+    Pyramid_Level* levels;
+    uint8_t palette[PALETTE_SIZE * 3];
+    uint8_t* nearest; //The palette colour nearest each 24 bit colour plus one, 0 until it is first needed
+    long ntiles; //Tiles written so far
+    int error;
+} Pyramid;
+
+//RETURN a monotonic time in seconds
+static double seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+Poster_Options poster_default_options()
+{
+    Poster_Options options;
+    options.mode = RENDER_BRUTE_FORCE;
+    options.pyramid = NULL;
+    options.progress = 1;
+    return options;
+}
+
+//RETURN whether text ends in suffix
+static int ends_with(const char* text, const char* suffix)
+{
+    int length = strlen(text), suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(text + length - suffix_length, suffix) == 0;
+}
+
+//RETURN the format of the poster at filename, from its extension
+static Poster_Format poster_format(const char* filename)
+{
+    if(ends_with(filename, ".pgm")) return POSTER_PGM;
+    if(ends_with(filename, ".raw")) return POSTER_RAW;
+    return POSTER_PPM;
+}
+
+//----------------------------------//
+
+//WRITES the tiles of the row of tiles of level which ends at row y, each as a gif of its own
+static void pyramid_tiles(Pyramid* pyramid, Pyramid_Level* level, int y)
+{
+    int tile_y = y / POSTER_TILE;
+    int rows = y % POSTER_TILE + 1;
+    char path[PYRAMID_PATH];
+
+    for(int tile_x = 0; tile_x * POSTER_TILE < level->width; tile_x++)
+    {
+        int x = tile_x * POSTER_TILE;
+        int columns = level->width - x < POSTER_TILE ? level->width - x : POSTER_TILE;
+
+        if(snprintf(path, sizeof(path), "%s/%d/%d_%d.gif", pyramid->files, level->number, tile_x, tile_y) >= (int) sizeof(path))
+        {
+            printf("The path of tile %d_%d of level %d is too long\n", tile_x, tile_y, level->number);
+            pyramid->error = 1;
+            return;
+        }
+
+        //No background index, which would make the inside of the set (colour 0) transparent
+        ge_Sink* sink = ge_sink_file(path);
+        ge_GIF* gif = ge_new_gif(sink, columns, rows, pyramid->palette, PALETTE_DEPTH, -1, -1);
+
+        if(gif == NULL)
+        {
+            if(sink != NULL) ge_sink_close(sink);
+            pyramid->error = 1;
+            return;
+        }
+
+        for(int row = 0; row < rows; row++) memcpy(gif->frame + row * columns, level->tiles + (long) row * level->width + x, columns);
+
+        ge_add_frame(gif, 0);
+        ge_close_gif(gif);
+        if(ge_sink_close(sink) != 0) pyramid->error = 1;
+
+        pyramid->ntiles++;
+    }
+}
+
+//RETURN the palette colour of the pyramid nearest to red, green, blue
+static uint8_t pyramid_colour(Pyramid* pyramid, int red, int green, int blue)
+{
+    uint8_t* nearest = &pyramid->nearest[(red << 16) | (green << 8) | blue];
+    if(*nearest != 0) return *nearest - 1;
+
+    int best = 0;
+    long best_distance = -1;
+
+    for(int i = 0; i < PALETTE_SIZE; i++)
+    {
+        const uint8_t* colour = &pyramid->palette[3 * i];
+        long distance = (long) (colour[0] - red) * (colour[0] - red) + (colour[1] - green) * (colour[1] - green) + (colour[2] - blue) * (colour[2] - blue);
+
+        if(best_distance < 0 || distance < best_distance)
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+
+    *nearest = best + 1;
+    return best;
+}
+
+/*
+    ADDS the next row of level index of the pyramid, writing its tiles once a row of them is full and halving
+    it into the levels below once its pair has arrived
+*/
+static void pyramid_row(Pyramid* pyramid, int index, const uint8_t* row)
+{
+    Pyramid_Level* level = &pyramid->levels[index];
+    int y = level->row++;
+
+    memcpy(level->tiles + (long) (y % POSTER_TILE) * level->width, row, level->width);
+    if(y % POSTER_TILE == POSTER_TILE - 1 || y == level->height - 1) pyramid_tiles(pyramid, level, y);
+
+    if(index + 1 == pyramid->nlevels) return;
+
+    //An odd row out at the bottom is halved with itself
+    if(y % 2 == 0)
+    {
+        memcpy(level->pair, row, level->width);
+        if(y < level->height - 1) return;
+    }
+
+    int half_width = pyramid->levels[index + 1].width;
+    const uint8_t* palette = pyramid->palette;
+
+    //The colours are averaged rather than their indices, which the palette need not keep in order
+    for(int x = 0; x < half_width; x++)
+    {
+        int left = 2 * x, right = 2 * x + 1 < level->width ? 2 * x + 1 : 2 * x;
+        int mean[3];
+
+        for(int channel = 0; channel < 3; channel++)
+        {
+            mean[channel] = (palette[3 * level->pair[left] + channel] + palette[3 * level->pair[right] + channel]
+                             + palette[3 * row[left] + channel] + palette[3 * row[right] + channel] + 2) / 4;
+        }
+
+        level->half[x] = pyramid_colour(pyramid, mean[0], mean[1], mean[2]);
+    }
+
+    pyramid_row(pyramid, index + 1, level->half);
+}
+
+static void deletePyramid(Pyramid* pyramid)
+{
+    for(int i = 0; i < pyramid->nlevels; i++)
+    {
+        free(pyramid->levels[i].tiles);
+        free(pyramid->levels[i].pair);
+        free(pyramid->levels[i].half);
+    }
+
+    free(pyramid->levels);
+    free(pyramid->nearest);
+    free(pyramid);
+}
+
+/*
+    RETURNS a new pyramid for a width by height picture, with its description written to path and the
+    directories of its levels made. RETURNS NULL if they could not be written
+*/
+static Pyramid* newPyramid(const char* path, int width, int height)
+{
+    //The tiles of poster.dzi go in poster_files
+    char files[PYRAMID_PATH];
+    int length = strlen(path);
+    if(ends_with(path, ".dzi")) length -= 4;
+    if(snprintf(files, sizeof(files), "%.*s_files", length, path) >= (int) sizeof(files)) return NULL;
+
+    FILE* file = fopen(path, "w");
+    if(file == NULL) return NULL;
+
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                  "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"gif\" Overlap=\"0\" TileSize=\"%d\">\n"
+                  "    <Size Width=\"%d\" Height=\"%d\"/>\n"
+                  "</Image>\n", POSTER_TILE, width, height);
+
+    if(fclose(file) != 0) return NULL;
+
+    Pyramid* pyramid = (Pyramid*) calloc(1, sizeof(Pyramid));
+    memcpy(pyramid->files, files, sizeof(files));
+
+    //Left by an earlier poster is fine, its tiles are written over
+    if(mkdir(pyramid->files, 0777) != 0 && errno != EEXIST)
+    {
+        free(pyramid);
+        return NULL;
+    }
+
+    //Levels are halved, rounding up, until they are a single pixel
+    pyramid->nlevels = 1;
+    for(int size = width > height ? width : height; size > 1; size = (size + 1) / 2) pyramid->nlevels++;
+
+    pyramid->levels = (Pyramid_Level*) calloc(pyramid->nlevels, sizeof(Pyramid_Level));
+
+    for(int i = 0; i < pyramid->nlevels; i++)
+    {
+        Pyramid_Level* level = &pyramid->levels[i];
+        level->number = pyramid->nlevels - 1 - i;
+        level->width = i == 0 ? width : (pyramid->levels[i - 1].width + 1) / 2;
+        level->height = i == 0 ? height : (pyramid->levels[i - 1].height + 1) / 2;
+        level->row = 0;
+        level->tiles = (uint8_t*) malloc((long) POSTER_TILE * level->width);
+        level->pair = (uint8_t*) malloc(level->width);
+        level->half = (uint8_t*) malloc((level->width + 1) / 2);
+
+        //Too long a path is found when the level's first tile is written
+        char directory[PYRAMID_PATH];
+        if(snprintf(directory, sizeof(directory), "%s/%d", pyramid->files, level->number) < (int) sizeof(directory)
+           && mkdir(directory, 0777) != 0 && errno != EEXIST)
+        {
+            deletePyramid(pyramid);
+            return NULL;
+        }
+    }
+
+    palette_rgb(pyramid->palette);
+    pyramid->nearest = (uint8_t*) calloc(1 << 24, 1);
+
+    return pyramid;
+}
+
+//----------------------------------//
+
+//PRINTS the progress line over the last one, once done of the rows are written
+static void print_progress(int done, int height, int width, double start, double* p_last)
+{
+    double now = seconds();
+    if(done < height && now - *p_last < PROGRESS_INTERVAL) return;
+    *p_last = now;
+
+    double rate = done / (now - start);
+    printf("\rRow %d/%d, %.2f megapixels/s, %.0fs left ", done, height, rate * width * 1e-6, (height - done) / rate);
+    if(done == height) printf("\n");
+    fflush(stdout);
+}
+
+int save_poster(const char* filename, int width, int height, Coord max, Coord mid, Pool* p_pool, Poster_Options options)
+{
+    Poster_Format format = poster_format(filename);
+    FILE* file = fopen(filename, "wb");
+
+    if(file == NULL)
+    {
+        printf("Could not create %s\n", filename);
+        return -1;
+    }
+
+    Pyramid* pyramid = NULL;
+
+    if(options.pyramid != NULL && options.pyramid[0] != '\0')
+    {
+        pyramid = newPyramid(options.pyramid, width, height);
+
+        if(pyramid == NULL)
+        {
+            printf("Could not create %s\n", options.pyramid);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    if(format == POSTER_PPM) fprintf(file, "P6\n%d %d\n255\n", width, height);
+    else if(format == POSTER_PGM) fprintf(file, "P5\n%d %d\n255\n", width, height);
+
+    uint8_t lut[MAX_ITERATIONS + 1], palette[PALETTE_SIZE * 3];
+    palette_lut(lut);
+    palette_rgb(palette);
+
+    //Only one band and one row of it are held at once
+    uint16_t* iters = (uint16_t*) malloc((long) width * POSTER_TILE * sizeof(uint16_t));
+    uint8_t* colours = (uint8_t*) malloc((long) width);
+    uint8_t* pixels = (uint8_t*) malloc((long) width * 3);
+
+    double start = seconds(), last_progress = 0;
+    int error = 0;
+    Precision precision = PRECISION_FLOAT;
+
+    //Bands start where rows of tiles do, so each gets the counts of a render of the whole view
+    int first = tile_row(width, height, max, mid);
+
+    for(int band = first > 0 ? first - POSTER_TILE : 0; band < height && !error; band += POSTER_TILE)
+    {
+        int y = band > 0 ? band : 0;
+        int rows = (height - band < POSTER_TILE ? height : band + POSTER_TILE) - y;
+        precision = render_band(p_pool, NULL, iters, width, height, max, mid, options.mode, y, rows);
+
+        if(format == POSTER_RAW) error = fwrite(iters, sizeof(uint16_t), (long) width * rows, file) != (size_t) width * rows;
+
+        for(int row = 0; row < rows && !error; row++)
+        {
+            uint16_t* counts = iters + (long) row * width;
+            for(int x = 0; x < width; x++) colours[x] = lut[counts[x]];
+
+            if(format == POSTER_PPM)
+            {
+                for(int x = 0; x < width; x++) memcpy(pixels + 3 * x, palette + 3 * colours[x], 3);
+                error = fwrite(pixels, 3, width, file) != (size_t) width;
+            }
+            else if(format == POSTER_PGM)
+            {
+                //The brightest channel of each colour
+                for(int x = 0; x < width; x++)
+                {
+                    const uint8_t* rgb = palette + 3 * colours[x];
+                    pixels[x] = rgb[0] > rgb[1] ? (rgb[0] > rgb[2] ? rgb[0] : rgb[2]) : (rgb[1] > rgb[2] ? rgb[1] : rgb[2]);
+                }
+                error = fwrite(pixels, 1, width, file) != (size_t) width;
+            }
+
+            if(pyramid != NULL) pyramid_row(pyramid, 0, colours);
+        }
+
+        if(pyramid != NULL && pyramid->error) error = 1;
+        if(options.progress && !error) print_progress(y + rows, height, width, start, &last_progress);
+    }
+
+    if(fclose(file) != 0) error = 1;
+
+    free(iters);
+    free(colours);
+    free(pixels);
+
+    double total = seconds() - start;
+
+    if(error)
+    {
+        printf("Could not write all of %s%s%s\n", filename, pyramid != NULL ? " and its pyramid " : "", pyramid != NULL ? options.pyramid : "");
+        if(pyramid != NULL) deletePyramid(pyramid);
+        return -1;
+    }
+
+    printf("%s created, %dx%d iterated in %s in %.2fs, %.2f megapixels/s\n", filename, width, height, precision_name(precision), total, (double) width * height / total * 1e-6);
+
+    if(pyramid != NULL)
+    {
+        printf("Pyramid of %d levels and %ld tiles written to %s\n", pyramid->nlevels, pyramid->ntiles, options.pyramid);
+        deletePyramid(pyramid);
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef _POSTER
+#define _POSTER
+
+//Renders stills of a single view far larger than memory, a band of rows at a time
+
+#include "helper.h"
+#include "pool.h"
+#include "frame.h"
+
+//The rows rendered at once, and the sidelength of the tiles of the pyramid. A multiple of TILE_SIZE
+#define POSTER_TILE 256
+
+//Settings for save_poster
+typedef struct Poster_Options
+{
+    //How the pixels of each band are found
+    Render_Mode mode;
+
+    //Where a Deep Zoom pyramid of the poster is described, eg "poster.dzi", its tiles going in "poster_files".
+    //NULL or empty to write none
+    const char* pyramid;
+
+    //Redraw a line with the rows done, megapixels/s and the time left as the poster is written
+    int progress;
+} Poster_Options;
+
+//RETURN the default settings for save_poster
+Poster_Options poster_default_options();
+
+/*
+    RENDERS a width by height still of the view to filename, a band of up to POSTER_TILE rows at a time. Each band
+    is written out as soon as it is rendered, so the memory used grows with the width but not the height.
+    The format follows the extension of filename: .pgm for the palette as shades of grey, .raw for the escape
+    counts themselves as 16 bit numbers in the machine's byte order with no header, and colour .ppm otherwise.
+    The pyramid, if any, holds the same picture as gif tiles of POSTER_TILE pixels, halved level by level down
+    to a single pixel as the bands arrive, for viewers such as OpenSeadragon.
+    RETURNS 0 once everything is written, -1 otherwise
+    Warning: max.real:max.imag :: width:height, otherwise the fractal will be stretched/compressed
+
+    \param filename The filename of the poster
+    \param width The width of the poster in pixels
+    \param height The height of the poster in pixels
+    \param max The largest coordinate on the poster
+    \param mid The coordinate at the centre of the poster
+    \param p_pool The thread pool the bands are computed on
+    \param options How the poster is rendered, and where its pyramid goes
+*/
+int save_poster(const char* filename, int width, int height, Coord max, Coord mid, Pool* p_pool, Poster_Options options);
+
+#endif // #ifndef _POSTER
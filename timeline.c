@@ -0,0 +1,265 @@
+#include "timeline.h"
+
+#include <float.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//The panels allocated by the first insert, doubled whenever they run out
+#define TIMELINE_CAPACITY 16
+
+//Written as a number, so a file of the other byte order reads it back reversed
+#define TIMELINE_ORDER 0x01020304
+
+//The start of a timeline file, see timeline_save. 64 bytes, so the panels after it stay aligned
+typedef struct Timeline_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t panel_size;
+    uint32_t mantissa; //LDBL_MANT_DIG
+    uint32_t order;
+    uint64_t npanels;
+    uint8_t reserved[32];
+} Timeline_Header;
+
+static const char timeline_magic[8] = {'F', 'R', 'A', 'C', 'T', 'I', 'M', 'L'};
+
+Timeline* newTimeline()
+{
+    Timeline* timeline = (Timeline*) calloc(1, sizeof(Timeline));
+    timeline->starts = (int*) calloc(1, sizeof(int));
+    return timeline;
+}
+
+void deleteTimeline(Timeline* timeline)
+{
+    for(int i = 0; i < timeline->npanels; i++)
+    {
+        if(timeline->counts[i] != NULL) deleteIterBuffer(timeline->counts[i]);
+    }
+
+    if(timeline->map != NULL) munmap(timeline->map, timeline->map_size);
+    else free(timeline->panels);
+
+    free(timeline->counts);
+    free(timeline->starts);
+    free(timeline);
+}
+
+//FILLS the starts of the panels from index on, those before it being up to date
+static void timeline_index(Timeline* timeline, int index)
+{
+    int n = timeline->npanels;
+
+    for(int i = index; i < n; i++)
+    {
+        //The last snapshot is shown on its own
+        int frames = i == n - 1 ? 1 : FRAMERATE * timeline->panels[i].duration + 1;
+        timeline->starts[i + 1] = timeline->starts[i] + frames;
+    }
+}
+
+//MAKES room for one more panel, copying the panels of a mapped file into memory
+static void timeline_grow(Timeline* timeline)
+{
+    int n = timeline->npanels;
+    if(timeline->map == NULL && n < timeline->capacity) return;
+
+    int capacity = timeline->capacity == 0 ? TIMELINE_CAPACITY : 2 * timeline->capacity;
+    while(capacity <= n) capacity *= 2;
+
+    if(timeline->map != NULL)
+    {
+        Panel* panels = (Panel*) malloc(capacity * sizeof(Panel));
+        memcpy(panels, timeline->panels, n * sizeof(Panel));
+        munmap(timeline->map, timeline->map_size);
+        timeline->map = NULL;
+        timeline->map_size = 0;
+        timeline->panels = panels;
+    }
+    else timeline->panels = (Panel*) realloc(timeline->panels, capacity * sizeof(Panel));
+
+    timeline->counts = (Iter_Buffer**) realloc(timeline->counts, capacity * sizeof(Iter_Buffer*));
+    timeline->starts = (int*) realloc(timeline->starts, (capacity + 1) * sizeof(int));
+    timeline->capacity = capacity;
+}
+
+void timeline_insert(Timeline* timeline, int index, Coord max, Coord mid, int duration, Iter_Buffer* counts)
+{
+    timeline_grow(timeline);
+
+    int after = timeline->npanels - index;
+    memmove(timeline->panels + index + 1, timeline->panels + index, after * sizeof(Panel));
+    memmove(timeline->counts + index + 1, timeline->counts + index, after * sizeof(Iter_Buffer*));
+
+    //Zeroed first, so the padding saved to files is too
+    Panel* panel = &timeline->panels[index];
+    memset(panel, 0, sizeof(Panel));
+    panel->max = max;
+    panel->mid = mid;
+    panel->duration = duration;
+
+    timeline->counts[index] = counts;
+    timeline->npanels++;
+
+    //The panel before it may have been the last
+    timeline_index(timeline, index > 0 ? index - 1 : 0);
+}
+
+void timeline_delete(Timeline* timeline, int index)
+{
+    //Deleting never needs more room, but a mapped file is read only
+    timeline_grow(timeline);
+
+    if(timeline->counts[index] != NULL) deleteIterBuffer(timeline->counts[index]);
+
+    int after = timeline->npanels - index - 1;
+    memmove(timeline->panels + index, timeline->panels + index + 1, after * sizeof(Panel));
+    memmove(timeline->counts + index, timeline->counts + index + 1, after * sizeof(Iter_Buffer*));
+    timeline->npanels--;
+
+    timeline_index(timeline, index > 0 ? index - 1 : 0);
+}
+
+int timeline_frames(const Timeline* timeline)
+{
+    return timeline->starts[timeline->npanels];
+}
+
+int timeline_find(const Timeline* timeline, int frame, int* p_local)
+{
+    //The last panel starting at or before frame
+    int low = 0, high = timeline->npanels - 1;
+
+    while(low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if(timeline->starts[middle] <= frame) low = middle;
+        else high = middle - 1;
+    }
+
+    *p_local = frame - timeline->starts[low];
+    return low;
+}
+
+void timeline_print(const Timeline* timeline)
+{
+    if(timeline->npanels == 0) printf("There are no panels yet.\n");
+
+    for(int i = 0; i < timeline->npanels; i++)
+    {
+        const Panel* panel = &timeline->panels[i];
+        printf("PANEL %d\n", i + 1);
+        printf("Midpoint: (%.21Lg, %.21Lg)\n", panel->mid.real, panel->mid.imag);
+        printf("Maxpoint: (%.21Lg, %.21Lg)\n", panel->max.real, panel->max.imag);
+        printf("Duration: %d seconds\n\n", panel->duration);
+    }
+}
+
+//----------------------------------//
+
+int timeline_save(const Timeline* timeline, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL) return -1;
+
+    Timeline_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, timeline_magic, sizeof(header.magic));
+    header.version = TIMELINE_VERSION;
+    header.panel_size = sizeof(Panel);
+    header.mantissa = LDBL_MANT_DIG;
+    header.order = TIMELINE_ORDER;
+    header.npanels = timeline->npanels;
+
+    int error = fwrite(&header, sizeof(header), 1, file) != 1;
+    if(!error) error = fwrite(timeline->panels, sizeof(Panel), timeline->npanels, file) != (size_t) timeline->npanels;
+
+    if(fclose(file) != 0) error = 1;
+    return error ? -1 : 0;
+}
+
+Timeline* timeline_load(const char* path)
+{
+    int descriptor = open(path, O_RDONLY);
+
+    if(descriptor < 0)
+    {
+        printf("Could not open %s\n", path);
+        return NULL;
+    }
+
+    struct stat status;
+    void* map = MAP_FAILED;
+    size_t size = 0;
+
+    if(fstat(descriptor, &status) == 0 && status.st_size >= (off_t) sizeof(Timeline_Header))
+    {
+        size = status.st_size;
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    }
+
+    //The mapping outlives the descriptor
+    close(descriptor);
+
+    if(map == MAP_FAILED)
+    {
+        printf("%s is not a timeline\n", path);
+        return NULL;
+    }
+
+    const Timeline_Header* header = (const Timeline_Header*) map;
+    const char* problem = NULL;
+
+    if(memcmp(header->magic, timeline_magic, sizeof(header->magic)) != 0) problem = "is not a timeline";
+    else if(header->version != TIMELINE_VERSION) problem = "is of another version of the timeline format";
+    else if(header->order != TIMELINE_ORDER || header->panel_size != sizeof(Panel) || header->mantissa != LDBL_MANT_DIG) problem = "was saved on a machine with another layout of numbers";
+    else if(header->npanels > (size - sizeof(Timeline_Header)) / sizeof(Panel) || size != sizeof(Timeline_Header) + header->npanels * sizeof(Panel)) problem = "is truncated or has extra bytes";
+    else if(header->npanels > INT32_MAX) problem = "has too many panels";
+
+    Timeline* timeline = NULL;
+
+    if(problem == NULL)
+    {
+        timeline = (Timeline*) calloc(1, sizeof(Timeline));
+        timeline->panels = (Panel*) ((char*) map + sizeof(Timeline_Header));
+        timeline->npanels = (int) header->npanels;
+        timeline->map = map;
+        timeline->map_size = size;
+        timeline->counts = (Iter_Buffer**) calloc(timeline->npanels > 0 ? timeline->npanels : 1, sizeof(Iter_Buffer*));
+        timeline->starts = (int*) calloc(timeline->npanels + 1, sizeof(int));
+
+        long frames = 0;
+
+        for(int i = 0; i < timeline->npanels && problem == NULL; i++)
+        {
+            const Panel* panel = &timeline->panels[i];
+            if(panel->duration < 0 || panel->max.real == 0 || !isfinite(panel->max.real) || !isfinite(panel->max.imag)
+               || !isfinite(panel->mid.real) || !isfinite(panel->mid.imag)) problem = "holds an invalid panel";
+
+            //The frame numbers are ints
+            frames += i == timeline->npanels - 1 ? 1 : FRAMERATE * (long) panel->duration + 1;
+            if(frames > INT32_MAX) problem = "has too many frames";
+        }
+
+        if(problem == NULL) timeline_index(timeline, 0);
+
+        if(problem != NULL)
+        {
+            deleteTimeline(timeline);
+            timeline = NULL;
+            map = NULL;
+        }
+    }
+
+    if(problem != NULL)
+    {
+        if(map != NULL) munmap(map, size);
+        printf("%s %s\n", path, problem);
+    }
+
+    return timeline;
+}
@@ -0,0 +1,83 @@
+#ifndef _TIMELINE
+#define _TIMELINE
+
+//The snapshots of a gif, kept in order in one array with the frame each one starts at
+
+#include "helper.h"
+#include "frame.h"
+
+//The version of the timeline files written by timeline_save. Files of other versions are refused
+#define TIMELINE_VERSION 1
+
+//A snapshot of the gif
+typedef struct Panel
+{
+    Coord max;
+    Coord mid;
+    int duration; //Seconds taken to reach the next snapshot
+} Panel;
+
+typedef struct Timeline
+{
+    Panel* panels;
+    int npanels;
+    int capacity; //The panels allocated, 0 while panels points into a mapped file
+
+    //The escape counts on screen when each snapshot was taken, NULL for those without. The gif reuses them
+    //for the snapshot's own frame
+    Iter_Buffer** counts;
+
+    //The first frame of each panel, npanels + 1 entries. The last is the number of frames of the gif
+    int* starts;
+
+    //The file panels points into, if it was loaded by timeline_load
+    void* map;
+    size_t map_size;
+} Timeline;
+
+//RETURN an empty timeline
+Timeline* newTimeline();
+
+//FREES the timeline, the counts of its panels and any file it was loaded from
+void deleteTimeline(Timeline* timeline);
+
+/*
+    INSERTS a panel at index, moving the panels from index on back by one. A mapped file is copied
+    into memory first
+
+    \param index From 0 to npanels, npanels adding it at the end
+    \param counts The counts on screen, owned by the timeline from now on. NULL for none
+*/
+void timeline_insert(Timeline* timeline, int index, Coord max, Coord mid, int duration, Iter_Buffer* counts);
+
+//DELETES the panel at index, from 0 to npanels - 1, and its counts
+void timeline_delete(Timeline* timeline, int index);
+
+//RETURN the number of frames in the gif of the timeline. Every panel but the last takes FRAMERATE frames a second, plus one
+int timeline_frames(const Timeline* timeline);
+
+/*
+    FINDS the panel which frame of the gif leaves from, by a binary search of the starts of the panels
+    RETURNS the index of the panel
+
+    \param frame From 0. Assumes frame < timeline_frames(timeline)
+    \param p_local Where the frame's index from the start of its panel is stored, from 0 to
+                   FRAMERATE * duration of the panel
+*/
+int timeline_find(const Timeline* timeline, int frame, int* p_local);
+
+//PRINT the panels of the timeline, numbered from 1
+void timeline_print(const Timeline* timeline);
+
+/*
+    WRITES the panels to a timeline file at path, without their counts. RETURNS 0 on success, -1 otherwise.
+    The file is a header of 64 bytes, then the panels as they are laid out in memory so it can be mapped
+    and used in place. The header holds the magic "FRACTIML", the version, sizeof(Panel), the digits of
+    long double, a byte order mark and the number of panels, so files of other machines are refused
+*/
+int timeline_save(const Timeline* timeline, const char* path);
+
+//RETURN the timeline saved at path, mapping the file rather than reading it. NULL after printing why if it could not be loaded
+Timeline* timeline_load(const char* path);
+
+#endif // #ifndef _TIMELINE